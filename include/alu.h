@@ -8,6 +8,9 @@ typedef enum {
     Add,
     Sub,
     Mul,
+    MulH,
+    MulHSU,
+    MulHU,
     Div,
     DivU,
     Rem,
@@ -20,11 +23,48 @@ typedef enum {
     And,
     Slt,
     SltU,
-    Nop
-} AluOp;
+    Nop,
 
-// Function declarations
-AluOp get_r_type_alu_op(uint8_t funct3, uint8_t funct7);
-AluOp get_i_type_alu_op(uint8_t funct3, uint8_t funct7);
+    // Vector-only operations (vector.c)
+    RSub,
+    Min,
+    MinU,
+    Max,
+    MaxU,
+    MulAcc,         // vd + vs1 * vs2
+    MulSubAcc,      // vd - vs1 * vs2
+    MulAdd,         // vs1 * vd + vs2
+    MulSubAdd,      // vs2 - vs1 * vd
+    Merge,          // v0 selects vs1 or vs2; unmasked it is a move
+    ElementIndex,
+    CmpEq,
+    CmpNe,
+    CmpLt,
+    CmpLtU,
+    CmpLe,
+    CmpLeU,
+    CmpGt,
+    CmpGtU,
+    RedSum,
+    RedAnd,
+    RedOr,
+    RedXor,
+    RedMin,
+    RedMinU,
+    RedMax,
+    RedMaxU,
+    MaskAnd,
+    MaskNand,
+    MaskAndNot,
+    MaskOr,
+    MaskNor,
+    MaskOrNot,
+    MaskXor,
+    MaskXnor,
+    MaskPopCount,
+    MaskFirst,
+    MoveToScalar,
+    MoveFromScalar
+} AluOp;
 
 #endif // ALU_H
\ No newline at end of file
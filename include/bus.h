@@ -0,0 +1,29 @@
+#ifndef BUS_H
+#define BUS_H
+
+#include <stdint.h>
+
+#define MAX_BUS_REGIONS 8
+
+// A memory-mapped device. Offsets are relative to the region base and
+// width is the access size in bytes (1, 2 or 4).
+typedef struct {
+    const char *name;
+    uint32_t base;
+    uint32_t size;
+    void *device;
+    uint32_t (*read)(void *device, uint32_t offset, uint8_t width);
+    void (*write)(void *device, uint32_t offset, uint32_t value, uint8_t width);
+} BusRegion;
+
+typedef struct DeviceBus {
+    BusRegion regions[MAX_BUS_REGIONS];
+    int num_regions;
+} DeviceBus;
+
+void initialize_bus(DeviceBus *bus);
+int bus_register_region(DeviceBus *bus, const BusRegion *region);
+int bus_read(DeviceBus *bus, uint32_t address, uint8_t width, uint32_t *value);
+int bus_write(DeviceBus *bus, uint32_t address, uint8_t width, uint32_t value);
+
+#endif // BUS_H
@@ -0,0 +1,24 @@
+#ifndef CLINT_H
+#define CLINT_H
+
+#include "bus.h"
+#include "machine.h"
+
+#define CLINT_BASE 0x02000000
+#define CLINT_SIZE 0x10000
+
+// Core-local interruptor with a single hart. mtime counts retired
+// instructions, so timer interrupts are deterministic from run to run.
+typedef struct Clint {
+    VirtualMachine *vm;
+    uint32_t msip;
+    uint64_t mtimecmp;
+    uint64_t mtime_offset;  // Applied when the guest writes mtime
+} Clint;
+
+void initialize_clint(Clint *clint, VirtualMachine *vm);
+int attach_clint(DeviceBus *bus, Clint *clint, uint32_t base);
+uint64_t clint_mtime(const Clint *clint);
+uint32_t clint_pending_interrupts(const Clint *clint);
+
+#endif // CLINT_H
@@ -0,0 +1,38 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdint.h>
+#include "machine.h"    // For SIZE_OF_MEMORY
+
+#define COVERAGE_MAP_BITS 16
+#define COVERAGE_MAP_SIZE (1 << COVERAGE_MAP_BITS)
+
+// AFL-compatible edge bitmap, NULL while coverage is disabled
+extern uint8_t *coverage_map;
+
+// Bitmap location of every instruction word in memory, hashed once by
+// initialize_coverage so recording an edge is two loads and no multiplies
+extern uint16_t *coverage_ids;
+
+int initialize_coverage(void);
+
+// Hashes a guest PC to a bitmap location (one multiply and one shift)
+static inline uint32_t coverage_location(uint32_t pc) {
+    return ((pc >> 1) * 0x9E3779B1u) >> (32 - COVERAGE_MAP_BITS);
+}
+
+// Targets outside memory are about to fault and are hashed on the spot
+static inline uint32_t coverage_id(uint32_t pc) {
+    return pc < SIZE_OF_MEMORY ? coverage_ids[pc >> 2] : coverage_location(pc);
+}
+
+// Records the control-flow edge from -> to, the same way AFL instruments
+// compiled code: the source location is shifted so A->B and B->A differ.
+// The source is the instruction just executed, so it is always in memory.
+static inline void coverage_record_edge(uint32_t from, uint32_t to) {
+    if (coverage_map) {
+        coverage_map[(coverage_ids[from >> 2] >> 1) ^ coverage_id(to)]++;
+    }
+}
+
+#endif // COVERAGE_H
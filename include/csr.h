@@ -0,0 +1,45 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include "machine.h"
+#include "fetch.h"
+
+// Machine-mode trap setup and handling
+#define CSR_MSTATUS 0x300
+#define CSR_MISA 0x301
+#define CSR_MIE 0x304
+#define CSR_MTVEC 0x305
+#define CSR_MSCRATCH 0x340
+#define CSR_MEPC 0x341
+#define CSR_MCAUSE 0x342
+#define CSR_MTVAL 0x343
+#define CSR_MIP 0x344
+
+// Vector extension state
+#define CSR_VSTART 0x008
+#define CSR_VL 0xC20
+#define CSR_VTYPE 0xC21
+#define CSR_VLENB 0xC22
+
+// Zicntr unprivileged counters (read-only)
+#define CSR_CYCLE 0xC00
+#define CSR_TIME 0xC01
+#define CSR_INSTRET 0xC02
+#define CSR_CYCLEH 0xC80
+#define CSR_TIMEH 0xC81
+#define CSR_INSTRETH 0xC82
+
+// Machine information (read-only)
+#define CSR_MVENDORID 0xF11
+#define CSR_MARCHID 0xF12
+#define CSR_MIMPID 0xF13
+#define CSR_MHARTID 0xF14
+
+#define MISA_RV32IMV ((1u << 30) | (1u << ('I' - 'A')) | (1u << ('M' - 'A')) | (1u << ('V' - 'A')))
+
+int read_csr(VirtualMachine *vm, uint32_t csr, uint32_t *value);
+int write_csr(VirtualMachine *vm, uint32_t csr, uint32_t value);
+void execute_csr_instruction(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+const char *csr_name(uint32_t csr);
+
+#endif // CSR_H
@@ -1,12 +1,14 @@
 #ifndef DECODE_H
 #define DECODE_H
 
+#include <stddef.h>
 #include "fetch.h"
 #include "machine.h"
 #include "alu.h"
 
 uint8_t get_opcode(uint32_t instruction);
 void decode_instruction(VirtualMachine *vm, Instruction *inst);
+void disassemble_instruction(const Instruction *inst, char *buffer, size_t size);
 void print_decoded_instruction(const Instruction *inst);
 
 #endif // DECODE_H
\ No newline at end of file
@@ -2,12 +2,18 @@
 #define FETCH_H
 
 #include "machine.h"
+#include "isa.h"
 
 typedef enum {
-    R_TYPE, I_TYPE, S_TYPE, B_TYPE, U_TYPE, J_TYPE, UNSUPPORTED_TYPE
+    R_TYPE, I_TYPE, S_TYPE, B_TYPE, U_TYPE, J_TYPE, V_TYPE, UNSUPPORTED_TYPE
 } InstructionType;
 
-typedef struct {
+// Scalar source registers actually read, as set by the format decoders. The
+// rs1/rs2 fields also carry immediates and vector register numbers.
+#define READS_RS1 0x1
+#define READS_RS2 0x2
+
+typedef struct Instruction {
     uint32_t inst;
     uint32_t left;
     uint32_t right;
@@ -20,7 +26,14 @@ typedef struct {
     uint8_t memop;
     uint8_t aluop;
     uint8_t opcode;
+    uint8_t fusion;
+    uint8_t vd;             // Vector destination (or store data) register
+    uint8_t reads;          // READS_* flags
+    uint32_t vreads;        // Vector registers read, one bit each
+    uint32_t vwrites;       // Vector registers written, one bit each
+    InstructionHandler handler;
     InstructionType type;
+    InstructionId id;
 } Instruction;
 
 uint32_t fetch_instruction(VirtualMachine *vm);
@@ -0,0 +1,18 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "fetch.h"
+
+typedef enum {
+    FUSION_NONE,
+    FUSION_LUI_ADDI,        // lui rd, hi; addi rd, rd, lo      -> rd = hi + lo
+    FUSION_AUIPC_JALR,      // auipc rd, hi; jalr rd, lo(rd)    -> far call
+    FUSION_AUIPC_LOAD,      // auipc rd, hi; lX rd, lo(rd)      -> PC-relative load
+    FUSION_SLT_BRANCH,      // slt[u] rd, a, b; beq/bne rd, x0  -> compare and branch
+    FUSION_ZERO_EXTEND      // slli rd, rs, k; srli rd, rd, k   -> rd = rs & mask
+} FusionKind;
+
+int fuse_instruction_pair(VirtualMachine *vm, Instruction *inst);
+const char *fusion_name(uint8_t fusion);
+
+#endif // FUSION_H
@@ -0,0 +1,16 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include "machine.h"
+
+typedef struct {
+    const char *input_path;         // File holding the test case, NULL for stdin
+    uint32_t buffer_address;        // Guest buffer that receives the input
+    uint32_t buffer_size;           // Largest input copied into the buffer
+    uint32_t persistent_iterations; // Inputs run by one forked child
+    uint64_t max_instructions;      // Per-input limit, treated as a hang
+} FuzzOptions;
+
+int run_fuzzer(VirtualMachine *vm, const FuzzOptions *options);
+
+#endif // FUZZ_H
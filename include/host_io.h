@@ -0,0 +1,15 @@
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include "machine.h"
+
+// sys_read and sys_write on host file descriptors. Guest fds 0-2 map to
+// vm->host_files, which must be non-blocking. A call that would block parks
+// the machine in VM_BLOCKED with the program counter back on the ECALL, so
+// it is simply executed again once wait_fd is ready.
+
+#define NUM_GUEST_FILES 3
+
+void host_file_syscall(VirtualMachine *vm, uint32_t number);
+
+#endif // HOST_IO_H
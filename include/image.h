@@ -0,0 +1,20 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "machine.h"
+#include "load_elf.h"
+
+// A program loaded once into an anonymous memory file. Every VM created
+// from the image maps it copy-on-write, so the pages of text and read-only
+// data are shared by all instances and each VM only owns the pages it has
+// written to.
+typedef struct {
+    int fd;
+    uint32_t entry;
+} GuestImage;
+
+int create_guest_image(GuestImage *image, const char *filename);
+int initialize_machine_from_image(VirtualMachine *vm, const GuestImage *image);
+void free_guest_image(GuestImage *image);
+
+#endif // IMAGE_H
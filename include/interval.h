@@ -0,0 +1,15 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include "machine.h"
+#include "timing.h"
+
+typedef struct {
+    uint64_t interval_length;   // Instructions between checkpoints
+    uint64_t max_instructions;  // Limit for the functional pass
+    int num_threads;            // Workers running detailed intervals
+} IntervalOptions;
+
+uint64_t run_interval_simulation(VirtualMachine *vm, const IntervalOptions *options, TimingModel *total);
+
+#endif // INTERVAL_H
@@ -0,0 +1,58 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+#include "alu.h"
+#include "machine.h"
+
+typedef enum {
+#define FORMAT(id, type, decoder, disassembler) id,
+#include "formats.def"
+#undef FORMAT
+    NUM_FORMATS
+} InstructionFormat;
+
+// What the timing models and plugins need to know about an instruction's
+// effect outside the register file
+typedef enum {
+    MEM_NONE,
+    MEM_LOAD,
+    MEM_STORE,
+    MEM_ECALL,
+    MEM_EBREAK,
+    MEM_MRET,
+    MEM_CSR,
+    MEM_VECTOR
+} MemOp;
+
+struct Instruction;
+
+// Runs the part of an instruction that is not a plain ALU operation (memory
+// access, system call, CSR or vector work) in the memory stage
+typedef void (*InstructionHandler)(VirtualMachine *vm, const struct Instruction *inst, int32_t *result);
+
+typedef enum {
+#define INSTRUCTION(id, mnemonic, mask, match, format, aluop, memop, handler, latency) INST_##id,
+#include "isa.def"
+#undef INSTRUCTION
+    NUM_INSTRUCTIONS,
+    INST_UNSUPPORTED = NUM_INSTRUCTIONS
+} InstructionId;
+
+typedef struct {
+    const char *mnemonic;
+    uint32_t mask;
+    uint32_t match;
+    InstructionFormat format;
+    AluOp aluop;
+    MemOp memop;
+    InstructionHandler handler;     // NULL for instructions that only use the ALU
+    uint8_t latency;
+} InstructionInfo;
+
+extern const InstructionInfo instruction_table[NUM_INSTRUCTIONS];
+
+void initialize_decoder(void);
+InstructionId lookup_instruction(uint32_t instruction);
+
+#endif // ISA_H
@@ -36,4 +36,7 @@ typedef struct {
     uint32_t p_align;
 } ELFProgramHeader;
 
+int load_elf_file(const char *filename, uint8_t *memory, uint32_t memory_size, uint32_t *program_counter, ELFHeader *elf_header);
+int check_elf_file(const ELFHeader *elf_header);
+
 #endif // LOAD_ELF_H
@@ -5,13 +5,74 @@
 
 #define NUM_OF_REGISTERS 32
 #define SIZE_OF_MEMORY (1 << 20)
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1 << PAGE_SHIFT)
+#define NUM_OF_PAGES (SIZE_OF_MEMORY >> PAGE_SHIFT)
+
+// Vector register length in bits, fixed at build time (make VLEN=...)
+#ifndef VLEN
+#define VLEN 256
+#endif
+#if VLEN < 64 || VLEN > 65536 || (VLEN & (VLEN - 1)) != 0
+#error "VLEN must be a power of two between 64 and 65536"
+#endif
+#define VLENB (VLEN / 8)
+#define VECTOR_REGISTER_BYTES (NUM_OF_REGISTERS * VLENB)
+#define VECTOR_PADDING 64   // Lets SIMD kernels read and write whole chunks past v31
+
+struct TimingModel;
+struct OooModel;
+struct DeviceBus;
+struct Clint;
+
+typedef enum {
+    VM_RUNNING,     // Executing instructions
+    VM_BLOCKED,     // Parked on an ECALL until wait_fd is ready; resumes by re-executing it
+    VM_STOPPED,     // End of program, EBREAK or instruction limit
+    VM_EXITED,      // Guest called sys_exit; exit_code holds its status
+    VM_FAULT        // Bad memory access or unsupported instruction
+} MachineState;
 
 typedef struct {
     uint32_t registers[NUM_OF_REGISTERS];
     uint32_t program_counter;
     uint8_t *memory;
+    uint8_t memory_mapped;          // memory is a private mapping of a GuestImage
+    uint8_t fuse_instructions;
+    uint8_t trace;
+    MachineState state;
+    int32_t exit_code;
+    uint64_t retired_instructions;
+    struct TimingModel *timing;     // Cycle model fed by every retired instruction, or NULL
+    struct OooModel *ooo;           // Out-of-order core model fed by every retired instruction, or NULL
+    uint8_t *dirty_pages;           // One flag per page set by stores, or NULL
+    uint8_t replay;                 // Re-executing recorded work: no guest-visible output
+    struct DeviceBus *bus;          // MMIO devices outside RAM, or NULL
+    struct Clint *clint;            // Timer and software interrupt source, or NULL
+    uint8_t block_start;            // Next instruction starts a block
+    uint32_t instruction_plugins;   // Plugins instrumenting the current block's instructions
+    uint32_t memory_plugins;        // Plugins instrumenting the current block's memory accesses
+    const int *host_files;          // Non-blocking host fds behind guest fds 0-2, or NULL for the syscall stubs
+    int wait_fd;                    // Host fd a VM_BLOCKED machine waits for
+    uint32_t wait_events;           // EPOLLIN or EPOLLOUT
+
+    // Machine-mode trap state
+    uint32_t mstatus;
+    uint32_t mie;
+    uint32_t mip;
+    uint32_t mtvec;
+    uint32_t mepc;
+    uint32_t mcause;
+    uint32_t mscratch;
+
+    // Vector state. Registers are contiguous, so a register group of any
+    // LMUL is a plain byte range starting at its first register.
+    uint32_t vl;
+    uint32_t vtype;
+    uint8_t vregs[VECTOR_REGISTER_BYTES + VECTOR_PADDING];
 } VirtualMachine;
 
+void initialize_machine_state(VirtualMachine *vm);
 void initialize_machine(VirtualMachine *vm);
 void free_machine(VirtualMachine *vm);
 int32_t extend_sign_bit(int32_t value, uint8_t sign_bit_location);
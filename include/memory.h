@@ -5,4 +5,11 @@
 
 void memory_stage(VirtualMachine *vm, Instruction *inst, int32_t *result);
 
+// Instruction handlers named in isa.def
+void execute_load(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+void execute_store(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+void execute_ecall(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+void execute_ebreak(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+void execute_mret(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+
 #endif // MEMORY_H
\ No newline at end of file
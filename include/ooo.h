@@ -0,0 +1,116 @@
+#ifndef OOO_H
+#define OOO_H
+
+#include <stdint.h>
+#include "fetch.h"
+
+// Trace-driven model of a superscalar out-of-order core. Every retired
+// instruction is placed on the core's timeline as it arrives: dispatch in
+// program order (limited by width, ROB, issue queue and load/store queue
+// space), issue once its renamed operands are ready and a functional unit
+// is free, complete after the latency from isa.def, and retire in order.
+// Wrong-path work is not simulated; a mispredicted branch instead holds the
+// front end until it resolves plus the redirect penalty.
+
+#define OOO_CALENDAR_SIZE 8192     // Cycles of functional-unit bookings kept (power of two)
+#define OOO_STORE_BUFFER_SIZE 256   // Recent store addresses tracked for forwarding (power of two)
+
+typedef enum {
+    FU_ALU,
+    FU_MUL,
+    FU_DIV,     // Not pipelined: busy for its whole latency
+    FU_MEM,     // Load/store address and data ports
+    NUM_FU_CLASSES
+} FunctionalUnitClass;
+
+typedef enum {
+    STALL_MISPREDICT,   // Front end waiting for a mispredicted branch to resolve
+    STALL_SERIALIZE,    // ECALL/EBREAK/MRET/CSR access draining the window
+    STALL_ROB,          // Reorder buffer full
+    STALL_IQ,           // Issue queue full
+    STALL_LSQ,          // Load/store queue full
+    NUM_STALL_REASONS
+} DispatchStall;
+
+typedef struct {
+    uint32_t width;                     // Instructions dispatched, issued and retired per cycle
+    uint32_t rob_size;
+    uint32_t iq_size;
+    uint32_t lsq_size;
+    uint32_t units[NUM_FU_CLASSES];
+    uint32_t mispredict_penalty;        // Cycles from branch resolution to dispatch of the correct path
+    uint32_t predictor_bits;            // log2 of the bimodal predictor and BTB entries
+} OooConfig;
+
+typedef struct {
+    uint64_t cycle;
+    uint32_t used;
+} CalendarSlot;
+
+typedef struct {
+    uint32_t address;
+    uint64_t ready;             // Cycle the stored data can be forwarded
+    uint64_t depth;             // Dataflow depth of the stored data
+} StoreEntry;
+
+typedef struct OooModel {
+    OooConfig config;
+
+    // Front end and dispatch
+    uint64_t fetch_cycle;               // Earliest dispatch cycle for the next instruction
+    DispatchStall fetch_reason;         // Why fetch_cycle was pushed out
+    uint64_t dispatch_cycle;
+    uint32_t dispatched_in_cycle;
+    uint8_t *counters;                  // Bimodal two-bit counters
+    uint32_t *targets;                  // Last target of each indirect jump
+
+    // Window occupancy
+    uint64_t *rob_retire;               // Retire cycle per ROB slot, in program order
+    uint64_t *lsq_retire;               // Retire cycle per LSQ slot, in program order
+    uint64_t *iq_issue;                 // Min-heap of issue cycles of queued instructions
+    uint32_t iq_count;
+    uint64_t rob_index;
+    uint64_t lsq_index;
+
+    // Renaming: only true dependences remain, so a register is just the cycle its newest value is ready
+    uint64_t register_ready[NUM_OF_REGISTERS];
+    uint64_t vector_ready[NUM_OF_REGISTERS];    // The same for each vector register
+    StoreEntry stores[OOO_STORE_BUFFER_SIZE];
+
+    // Execution resources
+    CalendarSlot *issue_slots;
+    CalendarSlot *unit_slots[NUM_FU_CLASSES];
+    uint64_t *divider_busy;
+
+    // Retirement
+    uint64_t retire_cycle;
+    uint32_t retired_in_cycle;
+
+    // Critical path through register and memory dataflow with unlimited resources
+    uint64_t register_depth[NUM_OF_REGISTERS];
+    uint64_t register_chain[NUM_OF_REGISTERS];
+    uint64_t vector_depth[NUM_OF_REGISTERS];
+    uint64_t vector_chain[NUM_OF_REGISTERS];
+    uint64_t critical_path;
+    uint64_t critical_chain;
+
+    // Statistics
+    uint64_t instructions;
+    uint64_t branches;
+    uint64_t mispredicts;
+    uint64_t loads_forwarded;
+    uint64_t dispatch_stalls[NUM_STALL_REASONS];
+    uint64_t operand_wait;              // Cycles between dispatch and operands ready
+    uint64_t unit_wait;                 // Cycles between operands ready and issue
+    uint64_t class_count[NUM_FU_CLASSES];
+} OooModel;
+
+void default_ooo_config(OooConfig *config);
+int parse_ooo_config(OooConfig *config, const char *options);
+int initialize_ooo_model(OooModel *model, const OooConfig *config);
+void free_ooo_model(OooModel *model);
+void ooo_model_retire(OooModel *model, const Instruction *inst, uint32_t pc, uint32_t next_pc, uint32_t address);
+uint64_t ooo_model_cycles(const OooModel *model);
+void print_ooo_report(const OooModel *model);
+
+#endif // OOO_H
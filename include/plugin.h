@@ -0,0 +1,58 @@
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include <stdint.h>
+#include "machine.h"
+#include "fetch.h"
+
+// Instrumentation plugins are shared objects loaded with dlopen. Each one
+// exports riscv_plugin_install(), which fills in a Plugin with the callbacks
+// it wants; callbacks left NULL cost nothing.
+//
+// A block starts at the program entry and after every instruction that
+// redirects the program counter. The first time a block start address is
+// seen, block_translate is called and returns the PLUGIN_WANT_* flags that
+// decide whether instruction_retire and memory_access fire for instructions
+// in that block. The answer is cached for the rest of the run.
+//
+// Macro-op fusion is turned off while any plugin has instruction_retire, so
+// every instruction is reported on its own. Callbacks may be called from
+// several threads when many VMs run at once.
+
+#define PLUGIN_API_VERSION 1
+#define PLUGIN_INSTALL_SYMBOL "riscv_plugin_install"
+#define MAX_PLUGINS 32
+
+#define PLUGIN_WANT_INSTRUCTIONS 0x1
+#define PLUGIN_WANT_MEMORY 0x2
+
+typedef struct {
+    const char *name;
+    void *data;     // Passed back to every callback
+
+    uint32_t (*block_translate)(void *data, VirtualMachine *vm, uint32_t pc);
+    void (*block_execute)(void *data, VirtualMachine *vm, uint32_t pc);
+    void (*instruction_retire)(void *data, VirtualMachine *vm, const Instruction *inst, uint32_t pc);
+    void (*memory_access)(void *data, VirtualMachine *vm, uint32_t address, uint8_t width, int is_store, uint32_t value);
+    void (*syscall)(void *data, VirtualMachine *vm, uint32_t number);    // Again on retry after parking
+    void (*finish)(void *data);
+} Plugin;
+
+typedef int (*PluginInstallFunction)(Plugin *plugin, int api_version, const char *args);
+
+// Event kinds subscribed to by at least one loaded plugin
+#define PLUGIN_EVENT_BLOCKS 0x1
+#define PLUGIN_EVENT_SYSCALL 0x2
+#define PLUGIN_EVENT_INSTRUCTIONS 0x4
+
+extern uint32_t plugin_events;
+
+int load_plugin(const char *path, const char *args);
+void unload_plugins(void);
+
+void plugin_enter_block(VirtualMachine *vm);
+void plugin_instruction_retired(VirtualMachine *vm, const Instruction *inst, uint32_t pc);
+void plugin_memory_access(VirtualMachine *vm, uint32_t address, uint8_t width, int is_store, uint32_t value);
+void plugin_syscall(VirtualMachine *vm, uint32_t number);
+
+#endif // PLUGIN_H
@@ -0,0 +1,9 @@
+#ifndef RUN_H
+#define RUN_H
+
+#include "machine.h"
+
+int step_instruction(VirtualMachine *vm);
+uint64_t run_machine(VirtualMachine *vm, uint64_t max_instructions);
+
+#endif // RUN_H
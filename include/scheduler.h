@@ -0,0 +1,28 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "image.h"
+
+// Runs many guests from one image on a small pool of worker threads. Every
+// connection accepted on a Unix socket becomes a new guest with the
+// connection as its fds 0-2. Runnable guests share a run queue and execute
+// SCHEDULER_TIME_SLICE instructions at a time. A guest whose sys_read or
+// sys_write would block is parked: it sits in an epoll set with a one-shot
+// registration and costs no CPU until its connection is ready, when it goes
+// back on the run queue. A resident guest is only its VirtualMachine and
+// the pages it has written.
+
+#define SCHEDULER_TIME_SLICE 20000     // Instructions per turn on a worker
+#define SCHEDULER_EVENTS 256           // Readiness events handled per epoll_wait
+
+typedef struct {
+    const char *socket_path;
+    int num_workers;
+    uint64_t max_guests;            // Stop accepting after this many connections (0: never)
+    uint64_t max_instructions;      // Per-guest instruction limit (0: none)
+} SchedulerOptions;
+
+int run_scheduler(const GuestImage *image, const SchedulerOptions *options);
+
+#endif // SCHEDULER_H
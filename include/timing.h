@@ -0,0 +1,30 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include "fetch.h"
+
+// Cycle model of the classic in-order five-stage pipeline: one instruction
+// issues per cycle, branches resolve in execute and are predicted not taken,
+// loads forward from the memory stage, and multi-cycle operations hold the
+// execute stage for their whole latency.
+#define PIPELINE_DEPTH 5
+#define BRANCH_PENALTY 2
+#define LOAD_USE_PENALTY 1
+
+typedef struct TimingModel {
+    uint64_t instructions;
+    uint64_t load_use_stalls;
+    uint64_t execute_stalls;
+    uint64_t control_stalls;
+    uint8_t pending_load_rd;        // Destination of the previous instruction if it was a load
+    uint32_t pending_load_vregs;    // Vector registers written by the previous instruction if it was a vector load
+} TimingModel;
+
+void initialize_timing_model(TimingModel *model);
+void timing_model_retire(TimingModel *model, const Instruction *inst, int redirected);
+void merge_timing_model(TimingModel *total, const TimingModel *part);
+uint64_t timing_model_cycles(const TimingModel *model);
+void print_timing_report(const TimingModel *model);
+
+#endif // TIMING_H
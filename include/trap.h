@@ -0,0 +1,23 @@
+#ifndef TRAP_H
+#define TRAP_H
+
+#include "machine.h"
+
+#define MSTATUS_MIE (1u << 3)
+#define MSTATUS_MPIE (1u << 7)
+#define MSTATUS_MPP (3u << 11)
+
+#define MIP_MSIP (1u << 3)
+#define MIP_MTIP (1u << 7)
+#define MIP_MEIP (1u << 11)
+
+#define CAUSE_INTERRUPT 0x80000000u
+#define CAUSE_MACHINE_SOFTWARE 3
+#define CAUSE_MACHINE_TIMER 7
+#define CAUSE_MACHINE_EXTERNAL 11
+
+void update_pending_interrupts(VirtualMachine *vm);
+void check_interrupts(VirtualMachine *vm);
+void return_from_trap(VirtualMachine *vm);
+
+#endif // TRAP_H
@@ -0,0 +1,24 @@
+#ifndef UART_H
+#define UART_H
+
+#include "bus.h"
+
+#define UART_BASE 0x10000000
+#define UART_SIZE 0x100
+
+// 16550-compatible UART whose receiver and transmitter are host fds
+typedef struct {
+    int input_fd;
+    int output_fd;
+    uint8_t ier;        // Interrupt enable
+    uint8_t lcr;        // Line control (bit 7 selects the divisor latch)
+    uint8_t mcr;        // Modem control
+    uint8_t scr;        // Scratch
+    uint8_t dll;        // Divisor latch low
+    uint8_t dlm;        // Divisor latch high
+} Uart;
+
+void initialize_uart(Uart *uart, int input_fd, int output_fd);
+int attach_uart(DeviceBus *bus, Uart *uart, uint32_t base);
+
+#endif // UART_H
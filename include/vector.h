@@ -0,0 +1,25 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stddef.h>
+#include "machine.h"
+#include "fetch.h"
+
+// RVV 1.0 integer subset for ELEN = 32: SEW of 8, 16 or 32 bits, integer
+// and fractional LMUL, vstart always zero. Tail and inactive elements are
+// left undisturbed, which satisfies both agnostic and undisturbed policies.
+
+#define VTYPE_VLMUL 0x7
+#define VTYPE_VSEW_SHIFT 3
+#define VTYPE_VTA (1u << 6)
+#define VTYPE_VMA (1u << 7)
+#define VTYPE_VILL (1u << 31)
+
+#define VECTOR_CHUNK 32     // Bytes per host SIMD operation (one AVX2 register)
+
+uint32_t vector_vlmax(uint32_t vtype);
+void decode_vector_operands(const VirtualMachine *vm, Instruction *inst);
+void execute_vector_instruction(VirtualMachine *vm, const Instruction *inst, int32_t *result);
+void format_vtype(uint32_t vtype, char *buffer, size_t size);
+
+#endif // VECTOR_H
@@ -1,151 +1,209 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include "machine.h"
-#include "fetch.h"
-#include "decode.h"
-#include "execute.h"
-#include "memory.h"
-#include "writeback.h"
-#include "load_elf.h"
-
-int load_elf_file(const char *filename, uint8_t *memory, uint32_t memory_size, uint32_t *program_counter, ELFHeader *elf_header) {
-    FILE *file = fopen(filename, "rb");
-    if (!file) {
-        fprintf(stderr, "Could not open file %s\n", filename);
-        return -1;
-    }
-
-    if (fread(elf_header, 1, sizeof(ELFHeader), file) != sizeof(ELFHeader)) {
-        fprintf(stderr, "Could not read ELF Header\n");
-        fclose(file);
-        return -1;
-    }
-
-    fseek(file, elf_header->e_phoff, SEEK_SET);
-    for (int i = 0; i < elf_header->e_phnum; i++) {
-        ELFProgramHeader program_header;
-        if (fread(&program_header, 1, sizeof(ELFProgramHeader), file) != sizeof(ELFProgramHeader)) {
-            fprintf(stderr, "Could not read program header\n");
-            fclose(file);
-            return -1;
-        }
-
-        if (program_header.p_type == PT_LOAD) {
-            if (program_header.p_vaddr + program_header.p_memsz > memory_size) {
-                fprintf(stderr, "Program header does not fit into memory\n");
-                fclose(file);
-                return -1;
-            }
-
-            fseek(file, program_header.p_offset, SEEK_SET);
-            fread(memory + program_header.p_vaddr, 1, program_header.p_filesz, file);
+#include "isa.h"
+#include "run.h"
+#include "fuzz.h"
+#include "timing.h"
+#include "ooo.h"
+#include "interval.h"
+#include "bus.h"
+#include "uart.h"
+#include "clint.h"
+#include "plugin.h"
+#include "image.h"
+#include "scheduler.h"
+
+#define DEFAULT_FUZZ_BUFFER (SIZE_OF_MEMORY - 0x10000)
+#define DEFAULT_FUZZ_BUFFER_SIZE 0x10000
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [options] <ELF file>\n", program);
+    fprintf(stderr, "  -q              Do not trace instructions\n");
+    fprintf(stderr, "  -m <count>      Maximum instructions to execute (default 1000000, or no limit per guest with -S)\n");
+    fprintf(stderr, "  -z              Fuzz mode: AFL edge coverage and forkserver (implies -q)\n");
+    fprintf(stderr, "  -i <file>       Fuzz input file (default stdin)\n");
+    fprintf(stderr, "  -b <address>    Guest address of the fuzz input buffer (default 0x%X)\n", DEFAULT_FUZZ_BUFFER);
+    fprintf(stderr, "  -s <size>       Size of the fuzz input buffer (default 0x%X)\n", DEFAULT_FUZZ_BUFFER_SIZE);
+    fprintf(stderr, "  -p <count>      Inputs per forked child in persistent mode (default 1)\n");
+    fprintf(stderr, "  -t              Report in-order pipeline timing\n");
+    fprintf(stderr, "  -o <config>     Report out-of-order core timing; config is \"default\" or key=value,...\n");
+    fprintf(stderr, "                  (width, rob, iq, lsq, alu, mul, div, mem, penalty, bpred)\n");
+    fprintf(stderr, "  -I <count>      Parallel interval timing with a checkpoint every <count> instructions (implies -q)\n");
+    fprintf(stderr, "  -j <threads>    Worker threads for interval timing or the scheduler (default: online CPUs)\n");
+    fprintf(stderr, "  -l <plugin>     Load an instrumentation plugin; arguments follow a comma (path.so,args)\n");
+    fprintf(stderr, "  -S <socket>     Serve: run a new guest for every connection to this Unix socket (implies -q)\n");
+    fprintf(stderr, "  -n <count>      Stop serving after <count> connections (default: never)\n");
+    fprintf(stderr, "  -d              Map a 16550 UART (stdin/stdout) at 0x%08X and a CLINT at 0x%08X\n", UART_BASE, CLINT_BASE);
+}
 
-            if (program_header.p_memsz > program_header.p_filesz) {
-                memset(memory + program_header.p_vaddr + program_header.p_filesz, 0, program_header.p_memsz - program_header.p_filesz);
+int main(int argc, char *argv[]) {
+    int trace = 1;
+    int fuzz = 0;
+    uint64_t max_instructions = 1000000; // Prevent infinite loops during testing
+    int limit_given = 0;
+    FuzzOptions fuzz_options = { NULL, DEFAULT_FUZZ_BUFFER, DEFAULT_FUZZ_BUFFER_SIZE, 1, 0 };
+    int timing = 0;
+    int devices = 0;
+    int out_of_order = 0;
+    OooConfig ooo_config;
+    default_ooo_config(&ooo_config);
+    IntervalOptions interval_options = { 0, 0, (int)sysconf(_SC_NPROCESSORS_ONLN) };
+    SchedulerOptions scheduler_options = { NULL, 0, 0, 0 };
+
+    int option;
+    while ((option = getopt(argc, argv, "qm:zi:b:s:p:to:I:j:dl:S:n:")) != -1) {
+        switch (option) {
+            case 'q': trace = 0; break;
+            case 'm': max_instructions = strtoull(optarg, NULL, 0); limit_given = 1; break;
+            case 'z': fuzz = 1; trace = 0; break;
+            case 'i': fuzz_options.input_path = optarg; break;
+            case 'b': fuzz_options.buffer_address = strtoul(optarg, NULL, 0); break;
+            case 's': fuzz_options.buffer_size = strtoul(optarg, NULL, 0); break;
+            case 'p': fuzz_options.persistent_iterations = strtoul(optarg, NULL, 0); break;
+            case 't': timing = 1; break;
+            case 'o':
+                if (parse_ooo_config(&ooo_config, optarg) != 0) return -1;
+                out_of_order = 1;
+                break;
+            case 'I': interval_options.interval_length = strtoull(optarg, NULL, 0); trace = 0; break;
+            case 'j': interval_options.num_threads = atoi(optarg); break;
+            case 'd': devices = 1; break;
+            case 'S': scheduler_options.socket_path = optarg; trace = 0; break;
+            case 'n': scheduler_options.max_guests = strtoull(optarg, NULL, 0); break;
+            case 'l': {
+                char *args = strchr(optarg, ',');
+                if (args) *args++ = '\0';
+                if (load_plugin(optarg, args ? args : "") != 0) return -1;
+                break;
             }
+            default:
+                print_usage(argv[0]);
+                return -1;
         }
     }
 
-    *program_counter = elf_header->e_entry;
-    fclose(file);
-    return 0;
-}
-
-int check_elf_file(const ELFHeader *elf_header) {
-    if (memcmp(elf_header->e_ident, "\x7f""ELF", 4) != 0) {
-        fprintf(stderr, "e_ident value is not valid\n");
+    if (optind != argc - 1 || fuzz_options.persistent_iterations == 0) {
+        print_usage(argv[0]);
         return -1;
     }
 
-    if (elf_header->e_type != ET_EXEC || elf_header->e_machine != EM_RISCV) {
-        fprintf(stderr, "Invalid ELF file for this machine\n");
+    if (devices && interval_options.interval_length > 0) {
+        // Replaying intervals would repeat every device side effect
+        fprintf(stderr, "Devices cannot be used with interval timing\n");
         return -1;
     }
 
-    return 0;
-}
-
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <ELF file>\n", argv[0]);
+    if (devices && fuzz) {
+        // Snapshot restores cover the machine and RAM, not device registers,
+        // so a timer armed by one input could fire during the next
+        fprintf(stderr, "Devices cannot be used with fuzzing\n");
         return -1;
     }
 
-    const char *filename = argv[1];
-    VirtualMachine vm;
-    initialize_machine(&vm);
-
-    ELFHeader elf_header;
+    if (out_of_order && (fuzz || interval_options.interval_length > 0)) {
+        fprintf(stderr, "Out-of-order timing cannot be combined with fuzzing or interval timing\n");
+        return -1;
+    }
 
-    // Load ELF file and validate
-    if (load_elf_file(filename, vm.memory, SIZE_OF_MEMORY, &vm.program_counter, &elf_header) != 0) {
-        free_machine(&vm);
+    if (scheduler_options.socket_path && (fuzz || timing || out_of_order || devices ||
+                                          interval_options.interval_length > 0)) {
+        // Guests do their I/O through syscalls and share the host's threads
+        fprintf(stderr, "Serving cannot be combined with fuzzing, timing or devices\n");
         return -1;
     }
 
-    if (check_elf_file(&elf_header) != 0) {
-        free_machine(&vm);
+    const char *filename = argv[optind];
+    GuestImage image;
+    if (create_guest_image(&image, filename) != 0) {
         return -1;
     }
 
-    printf("Program counter set to 0x%08X\n", vm.program_counter);
+    if (scheduler_options.socket_path) {
+        initialize_decoder();
+        scheduler_options.num_workers = interval_options.num_threads;
+        // Served guests are long-lived, so only an explicit -m limits them
+        scheduler_options.max_instructions = limit_given ? max_instructions : 0;
+        int exit_code = run_scheduler(&image, &scheduler_options);
+        unload_plugins();
+        free_guest_image(&image);
+        return exit_code;
+    }
 
-    int instruction_count = 0;
-    const int MAX_INSTRUCTIONS = 1000000; // Prevent infinite loops during testing
+    VirtualMachine vm;
+    if (initialize_machine_from_image(&vm, &image) != 0) {
+        free_guest_image(&image);
+        return -1;
+    }
+    initialize_decoder();
+    vm.trace = trace;
+    // Plugins see every instruction retire on its own
+    if (plugin_events & PLUGIN_EVENT_INSTRUCTIONS) vm.fuse_instructions = 0;
+
+    DeviceBus bus;
+    Uart uart;
+    Clint clint;
+    if (devices) {
+        initialize_bus(&bus);
+        initialize_uart(&uart, STDIN_FILENO, STDOUT_FILENO);
+        initialize_clint(&clint, &vm);
+        attach_uart(&bus, &uart, UART_BASE);
+        attach_clint(&bus, &clint, CLINT_BASE);
+        vm.bus = &bus;
+    }
 
-    while (instruction_count < MAX_INSTRUCTIONS) {
-        Instruction inst;
-        
-        // Fetch instruction
-        if (fetch(&vm, &inst) != 0) {
-            fprintf(stderr, "Error fetching instruction or end of program reached\n");
-            break;
-        }
+    if (fuzz) {
+        fuzz_options.max_instructions = max_instructions;
+        int exit_code = run_fuzzer(&vm, &fuzz_options);
+        unload_plugins();
+        free_machine(&vm);
+        free_guest_image(&image);
+        return exit_code;
+    }
 
-        // Check for null instruction (potential end of program)
-        if (inst.inst == 0) {
-            printf("Null instruction encountered, stopping execution\n");
-            break;
+    if (trace) printf("Program counter set to 0x%08X\n", vm.program_counter);
+
+    TimingModel timing_model;
+    OooModel ooo_model;
+    uint64_t instruction_count;
+
+    if (interval_options.interval_length > 0) {
+        interval_options.max_instructions = max_instructions;
+        instruction_count = run_interval_simulation(&vm, &interval_options, &timing_model);
+        timing = 1;
+    } else {
+        if (timing) {
+            // The pipeline model times instructions one at a time
+            initialize_timing_model(&timing_model);
+            vm.timing = &timing_model;
+            vm.fuse_instructions = 0;
         }
-
-        printf("Instruction #%d: PC=0x%08X, Inst=0x%08X\n", 
-               instruction_count + 1, vm.program_counter - 4, inst.inst);
-
-        // Decode the fetched instruction
-        decode_instruction(&vm, &inst);
-
-        // Check for unsupported instruction
-        if (inst.type == UNSUPPORTED_TYPE) {
-            fprintf(stderr, "Unsupported instruction: 0x%08X at PC=0x%08X\n", 
-                    inst.inst, vm.program_counter - 4);
-            break;
+        if (out_of_order) {
+            if (initialize_ooo_model(&ooo_model, &ooo_config) != 0) {
+                free_machine(&vm);
+                free_guest_image(&image);
+                return -1;
+            }
+            vm.ooo = &ooo_model;
+            vm.fuse_instructions = 0;
         }
-
-        // Print decoded instruction for debugging
-        print_decoded_instruction(&inst);
-
-        // Execute the instruction (includes PC updates for branches/jumps)
-        int32_t result;
-        execute_stage(&vm, &inst, &result);
-
-        // Perform memory operations (this may cause program termination via ECALL)
-        memory_stage(&vm, &inst, &result);
-
-        // Perform writeback stage
-        writeback_stage(&vm, &inst, result);
-
-        // Print result of the writeback stage
-        printf("Result after writeback: 0x%08X\n", result);
-        printf("------------------------\n");
-
-        instruction_count++;
+        instruction_count = run_machine(&vm, max_instructions);
     }
 
-    if (instruction_count >= MAX_INSTRUCTIONS) {
+    if (vm.state == VM_RUNNING) {
         fprintf(stderr, "Maximum instruction limit reached. Possible infinite loop.\n");
     }
 
-    printf("Executed %d instructions\n", instruction_count);
+    if (trace) printf("Executed %llu instructions\n", (unsigned long long)instruction_count);
+    if (timing) print_timing_report(&timing_model);
+    if (out_of_order) {
+        print_ooo_report(&ooo_model);
+        free_ooo_model(&ooo_model);
+    }
+    unload_plugins();
     free_machine(&vm);
-    return 0;
-}
\ No newline at end of file
+    free_guest_image(&image);
+    return vm.exit_code;
+}
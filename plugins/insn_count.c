@@ -0,0 +1,78 @@
+// Example plugin: counts executed blocks, retired instructions per
+// mnemonic, loads, stores and system calls.
+//
+//   make plugins
+//   ./riscv_emulator -q -l plugins/insn_count.so program
+//
+// Pass "blocks" as the argument (-l plugins/insn_count.so,blocks) to only
+// count blocks; no per-instruction callbacks are registered in that case,
+// which also keeps macro-op fusion on.
+//
+// Callbacks run on several threads under -S, so every counter is bumped
+// with a relaxed atomic add.
+
+#include <stdio.h>
+#include <string.h>
+#include "plugin.h"
+
+typedef struct {
+    int count_instructions;
+    uint64_t blocks;
+    uint64_t instructions[NUM_INSTRUCTIONS + 1];
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t syscalls;
+} InsnCount;
+
+static InsnCount counts;
+
+static uint32_t block_translate(void *data, VirtualMachine *vm, uint32_t pc) {
+    InsnCount *insn_count = data;
+    return insn_count->count_instructions ? PLUGIN_WANT_INSTRUCTIONS | PLUGIN_WANT_MEMORY : 0;
+}
+
+static void block_execute(void *data, VirtualMachine *vm, uint32_t pc) {
+    __atomic_fetch_add(&((InsnCount *)data)->blocks, 1, __ATOMIC_RELAXED);
+}
+
+static void instruction_retire(void *data, VirtualMachine *vm, const Instruction *inst, uint32_t pc) {
+    __atomic_fetch_add(&((InsnCount *)data)->instructions[inst->id], 1, __ATOMIC_RELAXED);
+}
+
+static void memory_access(void *data, VirtualMachine *vm, uint32_t address, uint8_t width, int is_store, uint32_t value) {
+    InsnCount *insn_count = data;
+    __atomic_fetch_add(is_store ? &insn_count->stores : &insn_count->loads, 1, __ATOMIC_RELAXED);
+}
+
+static void syscall(void *data, VirtualMachine *vm, uint32_t number) {
+    __atomic_fetch_add(&((InsnCount *)data)->syscalls, 1, __ATOMIC_RELAXED);
+}
+
+static void finish(void *data) {
+    InsnCount *insn_count = data;
+
+    printf("insn_count: %llu blocks, %llu loads, %llu stores, %llu syscalls\n",
+           (unsigned long long)insn_count->blocks, (unsigned long long)insn_count->loads,
+           (unsigned long long)insn_count->stores, (unsigned long long)insn_count->syscalls);
+    for (int id = 0; id < NUM_INSTRUCTIONS; id++) {
+        if (insn_count->instructions[id] == 0) continue;
+        printf("  %-8s %llu\n", instruction_table[id].mnemonic, (unsigned long long)insn_count->instructions[id]);
+    }
+}
+
+int riscv_plugin_install(Plugin *plugin, int api_version, const char *args) {
+    if (api_version != PLUGIN_API_VERSION) return -1;
+
+    counts.count_instructions = strcmp(args, "blocks") != 0;
+    plugin->name = "insn_count";
+    plugin->data = &counts;
+    plugin->block_translate = block_translate;
+    plugin->block_execute = block_execute;
+    if (counts.count_instructions) {
+        plugin->instruction_retire = instruction_retire;
+        plugin->memory_access = memory_access;
+    }
+    plugin->syscall = syscall;
+    plugin->finish = finish;
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "bus.h"
+#include <stdio.h>
+
+void initialize_bus(DeviceBus *bus) {
+    bus->num_regions = 0;
+}
+
+int bus_register_region(DeviceBus *bus, const BusRegion *region) {
+    if (bus->num_regions == MAX_BUS_REGIONS) {
+        fprintf(stderr, "Too many bus regions\n");
+        return -1;
+    }
+    bus->regions[bus->num_regions++] = *region;
+    return 0;
+}
+
+static BusRegion *find_region(DeviceBus *bus, uint32_t address, uint8_t width) {
+    for (int i = 0; i < bus->num_regions; i++) {
+        BusRegion *region = &bus->regions[i];
+        if (address - region->base < region->size && address - region->base + width <= region->size) {
+            return region;
+        }
+    }
+    return NULL;
+}
+
+// Returns -1 when no device is mapped at the address.
+int bus_read(DeviceBus *bus, uint32_t address, uint8_t width, uint32_t *value) {
+    BusRegion *region = find_region(bus, address, width);
+    if (!region) return -1;
+    *value = region->read(region->device, address - region->base, width);
+    return 0;
+}
+
+int bus_write(DeviceBus *bus, uint32_t address, uint8_t width, uint32_t value) {
+    BusRegion *region = find_region(bus, address, width);
+    if (!region) return -1;
+    region->write(region->device, address - region->base, value, width);
+    return 0;
+}
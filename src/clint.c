@@ -0,0 +1,66 @@
+#include "clint.h"
+#include "trap.h"
+
+// Register offsets
+#define CLINT_MSIP 0x0000
+#define CLINT_MTIMECMP 0x4000
+#define CLINT_MTIME 0xBFF8
+
+void initialize_clint(Clint *clint, VirtualMachine *vm) {
+    clint->vm = vm;
+    clint->msip = 0;
+    clint->mtimecmp = UINT64_MAX;
+    clint->mtime_offset = 0;
+}
+
+uint64_t clint_mtime(const Clint *clint) {
+    return clint->vm->retired_instructions + clint->mtime_offset;
+}
+
+uint32_t clint_pending_interrupts(const Clint *clint) {
+    uint32_t pending = 0;
+    if (clint->msip & 1) pending |= MIP_MSIP;
+    if (clint_mtime(clint) >= clint->mtimecmp) pending |= MIP_MTIP;
+    return pending;
+}
+
+// Accesses of any width are served from the 64-bit register they fall in
+static uint32_t extract_bytes(uint64_t value, uint32_t offset, uint8_t width) {
+    uint64_t shifted = value >> ((offset & 7) * 8);
+    return (uint32_t)(width == 4 ? shifted : shifted & ((1u << (width * 8)) - 1));
+}
+
+static uint64_t insert_bytes(uint64_t old, uint32_t offset, uint32_t value, uint8_t width) {
+    unsigned shift = (offset & 7) * 8;
+    uint64_t mask = (width == 4 ? 0xFFFFFFFFull : ((1ull << (width * 8)) - 1)) << shift;
+    return (old & ~mask) | (((uint64_t)value << shift) & mask);
+}
+
+static uint32_t clint_read(void *device, uint32_t offset, uint8_t width) {
+    Clint *clint = device;
+
+    if (offset < CLINT_MSIP + 4) return extract_bytes(clint->msip, offset, width);
+    if (offset >= CLINT_MTIMECMP && offset < CLINT_MTIMECMP + 8) return extract_bytes(clint->mtimecmp, offset, width);
+    if (offset >= CLINT_MTIME && offset < CLINT_MTIME + 8) return extract_bytes(clint_mtime(clint), offset, width);
+    return 0;
+}
+
+static void clint_write(void *device, uint32_t offset, uint32_t value, uint8_t width) {
+    Clint *clint = device;
+
+    if (offset < CLINT_MSIP + 4) {
+        clint->msip = (uint32_t)insert_bytes(clint->msip, offset, value, width) & 1;
+    } else if (offset >= CLINT_MTIMECMP && offset < CLINT_MTIMECMP + 8) {
+        clint->mtimecmp = insert_bytes(clint->mtimecmp, offset, value, width);
+    } else if (offset >= CLINT_MTIME && offset < CLINT_MTIME + 8) {
+        uint64_t mtime = insert_bytes(clint_mtime(clint), offset, value, width);
+        clint->mtime_offset = mtime - clint->vm->retired_instructions;
+    }
+}
+
+int attach_clint(DeviceBus *bus, Clint *clint, uint32_t base) {
+    BusRegion region = { "clint", base, CLINT_SIZE, clint, clint_read, clint_write };
+    if (bus_register_region(bus, &region) != 0) return -1;
+    clint->vm->clint = clint;
+    return 0;
+}
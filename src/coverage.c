@@ -0,0 +1,41 @@
+#include "coverage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/shm.h>
+
+uint8_t *coverage_map = NULL;
+uint16_t *coverage_ids = NULL;
+
+_Static_assert(COVERAGE_MAP_BITS <= 16, "coverage ids are 16 bits wide");
+
+// Attaches to the shared-memory bitmap created by afl-fuzz (passed through
+// __AFL_SHM_ID), or allocates a private one when running outside AFL, and
+// hashes the location of every instruction word.
+int initialize_coverage(void) {
+    coverage_ids = malloc((SIZE_OF_MEMORY >> 2) * sizeof(uint16_t));
+    if (!coverage_ids) {
+        fprintf(stderr, "Could not allocate coverage ids\n");
+        return -1;
+    }
+    for (uint32_t word = 0; word < (SIZE_OF_MEMORY >> 2); word++) {
+        coverage_ids[word] = (uint16_t)coverage_location(word << 2);
+    }
+
+    const char *shm_id = getenv("__AFL_SHM_ID");
+
+    if (shm_id) {
+        void *map = shmat(atoi(shm_id), NULL, 0);
+        if (map == (void *)-1) {
+            fprintf(stderr, "Could not attach coverage bitmap %s\n", shm_id);
+            return -1;
+        }
+        coverage_map = map;
+    } else {
+        coverage_map = calloc(COVERAGE_MAP_SIZE, 1);
+        if (!coverage_map) {
+            fprintf(stderr, "Could not allocate coverage bitmap\n");
+            return -1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "csr.h"
+#include "trap.h"
+#include "clint.h"
+#include "timing.h"
+#include "ooo.h"
+#include <stdio.h>
+
+// Counters are not maintained per instruction: each read derives its value
+// from state the emulator keeps anyway. instret is the retired-instruction
+// count, which excludes the reading instruction itself. cycle comes from the
+// attached timing model, or equals instret (CPI 1) without one. Interval
+// replays also use instret, so they see exactly the values the functional
+// pass saw. time is the CLINT's mtime, which counts retired instructions too.
+static uint64_t read_cycle(const VirtualMachine *vm) {
+    if (vm->ooo) return ooo_model_cycles(vm->ooo);
+    if (vm->timing && !vm->replay) return timing_model_cycles(vm->timing);
+    return vm->retired_instructions;
+}
+
+static uint64_t read_time(const VirtualMachine *vm) {
+    return vm->clint ? clint_mtime(vm->clint) : vm->retired_instructions;
+}
+
+// Returns -1 for a CSR that does not exist
+int read_csr(VirtualMachine *vm, uint32_t csr, uint32_t *value) {
+    switch (csr) {
+        case CSR_MSTATUS: *value = vm->mstatus; break;
+        case CSR_MISA: *value = MISA_RV32IMV; break;
+        case CSR_MIE: *value = vm->mie; break;
+        case CSR_MTVEC: *value = vm->mtvec; break;
+        case CSR_MSCRATCH: *value = vm->mscratch; break;
+        case CSR_MEPC: *value = vm->mepc; break;
+        case CSR_MCAUSE: *value = vm->mcause; break;
+        case CSR_MTVAL: *value = 0; break;
+        case CSR_MIP:
+            update_pending_interrupts(vm);
+            *value = vm->mip;
+            break;
+        case CSR_CYCLE: *value = (uint32_t)read_cycle(vm); break;
+        case CSR_CYCLEH: *value = (uint32_t)(read_cycle(vm) >> 32); break;
+        case CSR_TIME: *value = (uint32_t)read_time(vm); break;
+        case CSR_TIMEH: *value = (uint32_t)(read_time(vm) >> 32); break;
+        case CSR_INSTRET: *value = (uint32_t)vm->retired_instructions; break;
+        case CSR_INSTRETH: *value = (uint32_t)(vm->retired_instructions >> 32); break;
+        case CSR_VSTART: *value = 0; break;
+        case CSR_VL: *value = vm->vl; break;
+        case CSR_VTYPE: *value = vm->vtype; break;
+        case CSR_VLENB: *value = VLENB; break;
+        case CSR_MVENDORID:
+        case CSR_MARCHID:
+        case CSR_MIMPID:
+        case CSR_MHARTID:
+            *value = 0;
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+// Returns -1 for a CSR that does not exist or is read-only. Fields that
+// cannot change on this machine ignore writes.
+int write_csr(VirtualMachine *vm, uint32_t csr, uint32_t value) {
+    // CSR addresses with both top bits set are read-only by encoding
+    if ((csr >> 10) == 3) return -1;
+
+    switch (csr) {
+        case CSR_MSTATUS:
+            // Only machine mode exists, so MPP always reads as M
+            vm->mstatus = (value & (MSTATUS_MIE | MSTATUS_MPIE)) | MSTATUS_MPP;
+            break;
+        case CSR_MIE: vm->mie = value & (MIP_MSIP | MIP_MTIP | MIP_MEIP); break;
+        case CSR_MTVEC: vm->mtvec = value & ~2u; break;   // Direct or vectored mode
+        case CSR_MSCRATCH: vm->mscratch = value; break;
+        case CSR_MEPC: vm->mepc = value & ~3u; break;
+        case CSR_MCAUSE: vm->mcause = value; break;
+        case CSR_MISA:
+        case CSR_MTVAL:
+        case CSR_VSTART:    // Vector instructions never stop part-way
+        case CSR_MIP:   // Every pending bit is driven by a device
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+// CSRRW/CSRRS/CSRRC and their immediate forms. The old value goes to rd.
+// CSRRW with rd = x0 does not read, and CSRRS/CSRRC with a zero source
+// register or immediate do not write, so read-only counters can be read.
+void execute_csr_instruction(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
+    uint32_t csr = inst->right;
+    uint32_t source = inst->left;
+    uint32_t operation = inst->funct3 & 0x3;
+    uint32_t old = 0;
+    int status = 0;
+
+    if (operation != 1 || inst->rd != 0) {
+        status = read_csr(vm, csr, &old);
+    }
+
+    if (status == 0 && (operation == 1 || inst->rs1 != 0)) {
+        uint32_t value;
+        switch (operation) {
+            case 1: value = source; break;              // CSRRW
+            case 2: value = old | source; break;        // CSRRS
+            default: value = old & ~source; break;      // CSRRC
+        }
+        status = write_csr(vm, csr, value);
+    }
+
+    if (status != 0) {
+        fprintf(stderr, "Illegal CSR access: 0x%03X at PC=0x%08X\n", csr, vm->program_counter - 4);
+        vm->state = VM_FAULT;
+        vm->exit_code = 1;
+        return;
+    }
+
+    *result = (int32_t)old;
+    if (vm->trace) printf("CSR 0x%03X: 0x%08X\n", csr, old);
+}
+
+const char *csr_name(uint32_t csr) {
+    switch (csr) {
+        case CSR_MSTATUS: return "mstatus";
+        case CSR_MISA: return "misa";
+        case CSR_MIE: return "mie";
+        case CSR_MTVEC: return "mtvec";
+        case CSR_MSCRATCH: return "mscratch";
+        case CSR_MEPC: return "mepc";
+        case CSR_MCAUSE: return "mcause";
+        case CSR_MTVAL: return "mtval";
+        case CSR_MIP: return "mip";
+        case CSR_CYCLE: return "cycle";
+        case CSR_TIME: return "time";
+        case CSR_INSTRET: return "instret";
+        case CSR_CYCLEH: return "cycleh";
+        case CSR_TIMEH: return "timeh";
+        case CSR_INSTRETH: return "instreth";
+        case CSR_MVENDORID: return "mvendorid";
+        case CSR_MARCHID: return "marchid";
+        case CSR_MIMPID: return "mimpid";
+        case CSR_MHARTID: return "mhartid";
+        case CSR_VSTART: return "vstart";
+        case CSR_VL: return "vl";
+        case CSR_VTYPE: return "vtype";
+        case CSR_VLENB: return "vlenb";
+        default: return NULL;
+    }
+}
@@ -1,252 +1,397 @@
 #include "decode.h"
-#include "alu.h"
+#include "isa.h"
+#include "fusion.h"
+#include "csr.h"
+#include "vector.h"
 #include <stdio.h>
 
 uint8_t get_opcode(uint32_t instruction) {
     return instruction & 0x7F;
 }
 
-void decode_instruction(VirtualMachine *vm, Instruction *inst) {
-    uint8_t opcode = get_opcode(inst->inst);
-    inst->opcode = opcode;
-    
-    switch (opcode) {
-        case 0x33: // R-TYPE (Register-Register operations)
-            inst->type = R_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            inst->rs2 = (inst->inst >> 20) & 0x1F;
-            inst->funct7 = (inst->inst >> 25) & 0x7F;
-            inst->left = read_from_register(vm, inst->rs1);
-            inst->right = read_from_register(vm, inst->rs2);
-            inst->aluop = get_r_type_alu_op(inst->funct3, inst->funct7);
-            inst->memop = 0;
-            break;
-        
-        case 0x13: // I-TYPE (Immediate arithmetic)
-            inst->type = I_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            inst->left = read_from_register(vm, inst->rs1);
-            
-            // Extract 12-bit immediate and sign extend
-            int32_t imm = (inst->inst >> 20) & 0xFFF;
-            
-            // For shift operations, extract funct7 and limit immediate to 5 bits
-            if (inst->funct3 == 0x1 || inst->funct3 == 0x5) { // SLLI, SRLI, SRAI
-                inst->funct7 = (inst->inst >> 25) & 0x7F;
-                inst->right = imm & 0x1F; // Only use lower 5 bits for shift amount
-            } else {
-                inst->funct7 = 0;
-                inst->right = extend_sign_bit(imm, 11); // Sign extend from bit 11
-            }
-            
-            inst->disp_strval = inst->right;
-            inst->aluop = get_i_type_alu_op(inst->funct3, inst->funct7);
-            inst->memop = 0;
-            break;
-            
-        case 0x03: // I-TYPE (Load)
-            inst->type = I_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            inst->left = read_from_register(vm, inst->rs1);
-            
-            // Extract 12-bit immediate and sign extend
-            imm = (inst->inst >> 20) & 0xFFF;
-            inst->right = extend_sign_bit(imm, 11);
-            inst->disp_strval = inst->right;
-            inst->memop = 1; // Load operation
-            inst->aluop = Add; // Address calculation
-            inst->funct7 = 0;
-            break;
-            
-        case 0x23: // S-TYPE (Store)
-            inst->type = S_TYPE;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            inst->rs2 = (inst->inst >> 20) & 0x1F;
-            inst->left = read_from_register(vm, inst->rs1);
-            inst->disp_strval = read_from_register(vm, inst->rs2); // Value to store
-            
-            // Extract 12-bit immediate (bits 31:25 and 11:7)
-            imm = ((inst->inst >> 25) & 0x7F) << 5 | ((inst->inst >> 7) & 0x1F);
-            inst->right = extend_sign_bit(imm, 11);
-            inst->memop = 2; // Store operation
-            inst->aluop = Add; // Address calculation
-            inst->funct7 = 0;
-            inst->rd = 0; // No destination register for stores
-            break;
-            
-        case 0x63: // B-TYPE (Branch)
-            inst->type = B_TYPE;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            inst->rs2 = (inst->inst >> 20) & 0x1F;
-            inst->left = read_from_register(vm, inst->rs1);
-            inst->right = read_from_register(vm, inst->rs2);
-            
-            // Extract 13-bit immediate for branch offset
-            // Bits: 12|10:5|4:1|11 -> 31|30:25|11:8|7
-            imm = ((inst->inst >> 31) & 0x1) << 12 |     // bit 12
+// Per-format operand extraction. fetch() has already cleared every field,
+// so each extractor only fills in the fields its format defines.
+
+static void decode_r_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->rs2 = (inst->inst >> 20) & 0x1F;
+    inst->funct7 = (inst->inst >> 25) & 0x7F;
+    inst->left = read_from_register(vm, inst->rs1);
+    inst->right = read_from_register(vm, inst->rs2);
+    inst->reads = READS_RS1 | READS_RS2;
+}
+
+static void decode_i_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->left = read_from_register(vm, inst->rs1);
+    inst->reads = READS_RS1;
+
+    // Extract 12-bit immediate and sign extend
+    int32_t imm = (inst->inst >> 20) & 0xFFF;
+    inst->right = extend_sign_bit(imm, 11);
+    inst->disp_strval = inst->right;
+}
+
+static void decode_i_shift_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->funct7 = (inst->inst >> 25) & 0x7F;
+    inst->left = read_from_register(vm, inst->rs1);
+    inst->reads = READS_RS1;
+
+    // Only the lower 5 bits of the immediate hold the shift amount
+    inst->right = (inst->inst >> 20) & 0x1F;
+    inst->disp_strval = inst->right;
+}
+
+static void decode_s_format(VirtualMachine *vm, Instruction *inst) {
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->rs2 = (inst->inst >> 20) & 0x1F;
+    inst->left = read_from_register(vm, inst->rs1);
+    inst->disp_strval = read_from_register(vm, inst->rs2); // Value to store
+    inst->reads = READS_RS1 | READS_RS2;
+
+    // Extract 12-bit immediate (bits 31:25 and 11:7)
+    int32_t imm = ((inst->inst >> 25) & 0x7F) << 5 | ((inst->inst >> 7) & 0x1F);
+    inst->right = extend_sign_bit(imm, 11);
+}
+
+static void decode_b_format(VirtualMachine *vm, Instruction *inst) {
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->rs2 = (inst->inst >> 20) & 0x1F;
+    inst->left = read_from_register(vm, inst->rs1);
+    inst->right = read_from_register(vm, inst->rs2);
+    inst->reads = READS_RS1 | READS_RS2;
+
+    // Extract 13-bit immediate for branch offset
+    // Bits: 12|10:5|4:1|11 -> 31|30:25|11:8|7
+    int32_t imm = ((inst->inst >> 31) & 0x1) << 12 |     // bit 12
                   ((inst->inst >> 7) & 0x1) << 11 |      // bit 11
                   ((inst->inst >> 25) & 0x3F) << 5 |     // bits 10:5
                   ((inst->inst >> 8) & 0xF) << 1;        // bits 4:1
-            inst->disp_strval = extend_sign_bit(imm, 12);
-            
-            // Set ALU operation based on branch type for comparison
-            switch (inst->funct3) {
-                case 0x0: // BEQ
-                case 0x1: // BNE
-                    inst->aluop = Sub; // Compare by subtraction
-                    break;
-                case 0x4: // BLT
-                case 0x5: // BGE
-                    inst->aluop = Slt; // Signed comparison
-                    break;
-                case 0x6: // BLTU
-                case 0x7: // BGEU
-                    inst->aluop = SltU; // Unsigned comparison
-                    break;
-                default:
-                    inst->aluop = Nop;
-                    break;
-            }
-            
-            inst->memop = 0;
-            inst->funct7 = 0;
-            inst->rd = 0; // No destination register for branches
-            break;
-            
-        case 0x37: // U-TYPE (LUI - Load Upper Immediate)
-            inst->type = U_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            
-            // Extract 20-bit immediate and shift left by 12
-            imm = (inst->inst >> 12) & 0xFFFFF;
-            inst->right = imm << 12;
-            inst->left = 0; // LUI loads immediate directly
-            
-            inst->aluop = Add; // Simply pass through the immediate
-            inst->memop = 0;
-            inst->funct3 = 0;
-            inst->funct7 = 0;
-            inst->rs1 = 0;
-            inst->rs2 = 0;
-            inst->disp_strval = inst->right;
-            break;
-            
-        case 0x17: // U-TYPE (AUIPC - Add Upper Immediate to PC)
-            inst->type = U_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            
-            // Extract 20-bit immediate and shift left by 12
-            imm = (inst->inst >> 12) & 0xFFFFF;
-            inst->right = imm << 12;
-            inst->left = vm->program_counter - 4; // Current PC (before increment)
-            
-            inst->aluop = Add; // Add immediate to PC
-            inst->memop = 0;
-            inst->funct3 = 0;
-            inst->funct7 = 0;
-            inst->rs1 = 0;
-            inst->rs2 = 0;
-            inst->disp_strval = inst->right;
-            break;
-            
-        case 0x6F: // J-TYPE (JAL - Jump and Link)
-            inst->type = J_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            
-            // Extract 21-bit immediate for jump offset
-            // Bits: 20|10:1|11|19:12 -> 31|30:21|20|19:12
-            imm = ((inst->inst >> 31) & 0x1) << 20 |      // bit 20
+    inst->disp_strval = extend_sign_bit(imm, 12);
+}
+
+static void decode_u_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->right = inst->inst & 0xFFFFF000;
+    inst->left = 0; // LUI loads immediate directly
+    inst->disp_strval = inst->right;
+}
+
+static void decode_u_pc_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->right = inst->inst & 0xFFFFF000;
+    inst->left = vm->program_counter - 4; // Current PC (before increment)
+    inst->disp_strval = inst->right;
+}
+
+static void decode_j_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+
+    // Extract 21-bit immediate for jump offset
+    // Bits: 20|10:1|11|19:12 -> 31|30:21|20|19:12
+    int32_t imm = ((inst->inst >> 31) & 0x1) << 20 |      // bit 20
                   ((inst->inst >> 12) & 0xFF) << 12 |     // bits 19:12
                   ((inst->inst >> 20) & 0x1) << 11 |      // bit 11
                   ((inst->inst >> 21) & 0x3FF) << 1;      // bits 10:1
-            inst->disp_strval = extend_sign_bit(imm, 20);
-            
-            inst->left = vm->program_counter - 4; // Current PC
-            inst->right = inst->disp_strval;
-            inst->aluop = Add; // Calculate target address
-            inst->memop = 0;
-            inst->funct3 = 0;
-            inst->funct7 = 0;
-            inst->rs1 = 0;
-            inst->rs2 = 0;
-            break;
-            
-        case 0x67: // I-TYPE (JALR - Jump and Link Register)
-            inst->type = I_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            inst->left = read_from_register(vm, inst->rs1);
-            
-            // Extract 12-bit immediate and sign extend
-            imm = (inst->inst >> 20) & 0xFFF;
-            inst->right = extend_sign_bit(imm, 11);
-            inst->disp_strval = inst->right;
-            
-            inst->aluop = Add; // Calculate target address (rs1 + imm)
-            inst->memop = 0;
-            inst->funct7 = 0;
-            inst->rs2 = 0;
-            break;
-            
-        case 0x73: // SYSTEM (ECALL, EBREAK)
-            inst->type = I_TYPE;
-            inst->rd = (inst->inst >> 7) & 0x1F;
-            inst->funct3 = (inst->inst >> 12) & 0x07;
-            inst->rs1 = (inst->inst >> 15) & 0x1F;
-            imm = (inst->inst >> 20) & 0xFFF;
-            
-            if (imm == 0) {
-                // ECALL - Environment call (system call)
-                inst->aluop = Nop;
-                inst->memop = 3; // Special value for system call
-            } else if (imm == 1) {
-                // EBREAK - Environment break (debugger breakpoint)
-                inst->aluop = Nop;
-                inst->memop = 4; // Special value for breakpoint
-            }
-            
-            inst->left = 0;
-            inst->right = 0;
-            inst->disp_strval = 0;
-            inst->funct7 = 0;
-            inst->rs2 = 0;
-            break;
-
-        default:
-            inst->type = UNSUPPORTED_TYPE;
-            inst->aluop = Nop;
-            inst->memop = 0;
-            inst->rd = 0;
-            inst->rs1 = 0;
-            inst->rs2 = 0;
-            inst->funct3 = 0;
-            inst->funct7 = 0;
-            inst->left = 0;
-            inst->right = 0;
-            inst->disp_strval = 0;
-            break;
+    inst->disp_strval = extend_sign_bit(imm, 20);
+
+    inst->left = vm->program_counter - 4; // Current PC
+    inst->right = inst->disp_strval;
+}
+
+static void decode_system_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+}
+
+static void decode_csr_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+
+    // The immediate forms use the rs1 field as a zero-extended value
+    inst->left = (inst->funct3 & 0x4) ? inst->rs1 : read_from_register(vm, inst->rs1);
+    inst->reads = (inst->funct3 & 0x4) ? 0 : READS_RS1;
+    inst->right = inst->inst >> 20; // CSR number
+    inst->disp_strval = inst->right;
+}
+
+// Vector formats. Vector register numbers go to vd, rs1 and rs2; rd is only
+// set when the instruction writes a scalar register. vreads and vwrites
+// list the vector registers used.
+
+static void decode_vsetvli_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->left = read_from_register(vm, inst->rs1);     // AVL
+    inst->reads = READS_RS1;
+    inst->right = (inst->inst >> 20) & 0x7FF;           // vtype
+}
+
+static void decode_vsetivli_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->left = inst->rs1;                             // AVL immediate
+    inst->right = (inst->inst >> 20) & 0x3FF;           // vtype
+}
+
+static void decode_vsetvl_format(VirtualMachine *vm, Instruction *inst) {
+    inst->rd = (inst->inst >> 7) & 0x1F;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->rs2 = (inst->inst >> 20) & 0x1F;
+    inst->left = read_from_register(vm, inst->rs1);
+    inst->right = read_from_register(vm, inst->rs2);
+    inst->reads = READS_RS1 | READS_RS2;
+}
+
+static void decode_vmem_format(VirtualMachine *vm, Instruction *inst) {
+    inst->vd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;           // Element width
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->rs2 = (inst->inst >> 20) & 0x1F;              // Stride register or lumop/sumop
+    inst->funct7 = (inst->inst >> 25) & 0x7F;           // Bit 0 is vm
+    inst->left = read_from_register(vm, inst->rs1);     // Base address
+    inst->reads = READS_RS1;
+    decode_vector_operands(vm, inst);
+}
+
+static void decode_vmem_strided_format(VirtualMachine *vm, Instruction *inst) {
+    decode_vmem_format(vm, inst);
+    inst->disp_strval = read_from_register(vm, inst->rs2);
+    inst->reads |= READS_RS2;
+}
+
+static void decode_vector_format(VirtualMachine *vm, Instruction *inst) {
+    inst->vd = (inst->inst >> 7) & 0x1F;
+    inst->funct3 = (inst->inst >> 12) & 0x07;
+    inst->rs1 = (inst->inst >> 15) & 0x1F;
+    inst->rs2 = (inst->inst >> 20) & 0x1F;
+    inst->funct7 = (inst->inst >> 25) & 0x7F;           // funct6 and vm
+
+    // Scalar operand of the .vx and .vi forms; shift amounts are unsigned
+    if (inst->funct3 == 3) {
+        int is_shift = inst->aluop == LeftShift || inst->aluop == RightShiftL || inst->aluop == RightShiftA;
+        inst->left = is_shift ? inst->rs1 : extend_sign_bit(inst->rs1, 4);
+    } else if (inst->funct3 == 4 || inst->funct3 == 6) {
+        inst->left = read_from_register(vm, inst->rs1);
+        inst->reads = READS_RS1;
+    }
+    decode_vector_operands(vm, inst);
+}
+
+static void decode_vector_to_scalar_format(VirtualMachine *vm, Instruction *inst) {
+    decode_vector_format(vm, inst);
+    inst->rd = inst->vd;
+    inst->vd = 0;
+}
+
+static const char *register_names[NUM_OF_REGISTERS] = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+    "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+    "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
+// Per-format disassembly into buffer
+
+static const char *vector_mask(const Instruction *inst) {
+    return (inst->funct7 & 1) ? "" : ", v0.t";
+}
+
+static void disassemble_r_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, %s, %s", mnemonic, register_names[inst->rd],
+             register_names[inst->rs1], register_names[inst->rs2]);
+}
+
+static void disassemble_i_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    const char *rd = register_names[inst->rd];
+    const char *rs1 = register_names[inst->rs1];
+    int32_t imm = (int32_t)inst->disp_strval;
+
+    if (inst->memop == MEM_LOAD || inst->id == INST_JALR) {
+        snprintf(buffer, size, "%s %s, %d(%s)", mnemonic, rd, imm, rs1);
+    } else {
+        snprintf(buffer, size, "%s %s, %s, %d", mnemonic, rd, rs1, imm);
+    }
+}
+
+static void disassemble_i_shift_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, %s, %d", mnemonic, register_names[inst->rd],
+             register_names[inst->rs1], (int32_t)inst->disp_strval);
+}
+
+static void disassemble_s_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, %d(%s)", mnemonic, register_names[inst->rs2],
+             (int32_t)inst->right, register_names[inst->rs1]);
+}
+
+static void disassemble_b_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, %s, %d", mnemonic, register_names[inst->rs1],
+             register_names[inst->rs2], (int32_t)inst->disp_strval);
+}
+
+static void disassemble_u_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, 0x%X", mnemonic, register_names[inst->rd], inst->disp_strval >> 12);
+}
+
+static void disassemble_j_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, %d", mnemonic, register_names[inst->rd], (int32_t)inst->disp_strval);
+}
+
+static void disassemble_system_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s", mnemonic);
+}
+
+static void disassemble_csr_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    const char *rd = register_names[inst->rd];
+    char number[8];
+    const char *csr = csr_name(inst->right);
+    if (!csr) {
+        snprintf(number, sizeof(number), "0x%03X", inst->right);
+        csr = number;
+    }
+
+    if (inst->funct3 & 0x4) {
+        snprintf(buffer, size, "%s %s, %s, %u", mnemonic, rd, csr, inst->rs1);
+    } else {
+        snprintf(buffer, size, "%s %s, %s, %s", mnemonic, rd, csr, register_names[inst->rs1]);
     }
 }
 
+static void disassemble_vsetvli_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    char vtype[32];
+    format_vtype(inst->right, vtype, sizeof(vtype));
+    snprintf(buffer, size, "%s %s, %s, %s", mnemonic, register_names[inst->rd], register_names[inst->rs1], vtype);
+}
+
+static void disassemble_vsetivli_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    char vtype[32];
+    format_vtype(inst->right, vtype, sizeof(vtype));
+    snprintf(buffer, size, "%s %s, %u, %s", mnemonic, register_names[inst->rd], inst->rs1, vtype);
+}
+
+static void disassemble_vmem_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s v%u, (%s)%s", mnemonic, inst->vd, register_names[inst->rs1], vector_mask(inst));
+}
+
+static void disassemble_vmem_strided_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s v%u, (%s), %s%s", mnemonic, inst->vd, register_names[inst->rs1],
+             register_names[inst->rs2], vector_mask(inst));
+}
+
+// Third operand by funct3: vector register, immediate or scalar register
+static void vector_source(const Instruction *inst, char *buffer, size_t size) {
+    if (inst->funct3 == 0 || inst->funct3 == 2) snprintf(buffer, size, "v%u", inst->rs1);
+    else if (inst->funct3 == 3) snprintf(buffer, size, "%d", (int32_t)inst->left);
+    else snprintf(buffer, size, "%s", register_names[inst->rs1]);
+}
+
+static void disassemble_varith_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    char source[8];
+    vector_source(inst, source, sizeof(source));
+
+    if (inst->aluop >= MulAcc && inst->aluop <= MulSubAdd) {
+        // Multiply-add operands are written vd, vs1/rs1, vs2
+        snprintf(buffer, size, "%s v%u, %s, v%u%s", mnemonic, inst->vd, source, inst->rs2, vector_mask(inst));
+    } else {
+        snprintf(buffer, size, "%s v%u, v%u, %s%s", mnemonic, inst->vd, inst->rs2, source,
+                 inst->aluop == Merge ? ", v0" : vector_mask(inst));
+    }
+}
+
+static void disassemble_vmove_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    char source[8];
+    vector_source(inst, source, sizeof(source));
+    snprintf(buffer, size, "%s v%u, %s", mnemonic, inst->vd, source);
+}
+
+static void disassemble_vdest_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s v%u%s", mnemonic, inst->vd, vector_mask(inst));
+}
+
+static void disassemble_vtox_format(const Instruction *inst, const char *mnemonic, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s %s, v%u%s", mnemonic, register_names[inst->rd], inst->rs2, vector_mask(inst));
+}
+
+// Per-format tables generated from formats.def
+
+static const InstructionType format_types[NUM_FORMATS] = {
+#define FORMAT(id, type, decoder, disassembler) [id] = type,
+#include "formats.def"
+#undef FORMAT
+};
+
+static void (*const format_decoders[NUM_FORMATS])(VirtualMachine *vm, Instruction *inst) = {
+#define FORMAT(id, type, decoder, disassembler) [id] = decoder,
+#include "formats.def"
+#undef FORMAT
+};
+
+static void (*const format_disassemblers[NUM_FORMATS])(const Instruction *inst, const char *mnemonic,
+                                                        char *buffer, size_t size) = {
+#define FORMAT(id, type, decoder, disassembler) [id] = disassembler,
+#include "formats.def"
+#undef FORMAT
+};
+
+void decode_instruction(VirtualMachine *vm, Instruction *inst) {
+    inst->opcode = get_opcode(inst->inst);
+    inst->id = lookup_instruction(inst->inst);
+
+    if (inst->id == INST_UNSUPPORTED) {
+        inst->type = UNSUPPORTED_TYPE;
+        inst->aluop = Nop;
+        inst->memop = MEM_NONE;
+        return;
+    }
+
+    const InstructionInfo *info = &instruction_table[inst->id];
+    inst->type = format_types[info->format];
+    inst->aluop = info->aluop;
+    inst->memop = info->memop;
+    inst->handler = info->handler;
+    format_decoders[info->format](vm, inst);
+
+    // Merge the next instruction into this one when the pair is an idiom
+    fuse_instruction_pair(vm, inst);
+}
+
+void disassemble_instruction(const Instruction *inst, char *buffer, size_t size) {
+    if (inst->id == INST_UNSUPPORTED) {
+        snprintf(buffer, size, "unknown 0x%08X", inst->inst);
+        return;
+    }
+
+    const InstructionInfo *info = &instruction_table[inst->id];
+    format_disassemblers[info->format](inst, info->mnemonic, buffer, size);
+}
+
 void print_decoded_instruction(const Instruction *inst) {
-    printf("Instruction: 0x%08X\n", inst->inst);
+    char disassembly[64];
+    disassemble_instruction(inst, disassembly, sizeof(disassembly));
+
+    printf("Instruction: 0x%08X  %s\n", inst->inst, disassembly);
     printf("Opcode: 0x%02X\n", inst->opcode);
-    
-    const char* type_names[] = {"R_TYPE", "I_TYPE", "S_TYPE", "B_TYPE", "U_TYPE", "J_TYPE", "UNSUPPORTED_TYPE"};
+    if (inst->fusion != FUSION_NONE) {
+        printf("Fused: %s\n", fusion_name(inst->fusion));
+    }
+
+    const char* type_names[] = {"R_TYPE", "I_TYPE", "S_TYPE", "B_TYPE", "U_TYPE", "J_TYPE", "V_TYPE", "UNSUPPORTED_TYPE"};
     printf("Type: %s\n", type_names[inst->type]);
-    
+
     printf("rd: %u, rs1: %u, rs2: %u\n", inst->rd, inst->rs1, inst->rs2);
     printf("funct3: 0x%X, funct7: 0x%X\n", inst->funct3, inst->funct7);
     printf("Left: 0x%08X, Right: 0x%08X\n", inst->left, inst->right);
     printf("disp_strval: 0x%08X\n", inst->disp_strval);
     printf("ALU Op: %d, Mem Op: %d\n", inst->aluop, inst->memop);
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "execute.h"
+#include "coverage.h"
 
 int32_t perform_alu_operation(AluOp operation, int32_t left, int32_t right) {
     switch (operation) {
@@ -9,11 +10,19 @@ int32_t perform_alu_operation(AluOp operation, int32_t left, int32_t right) {
             return left - right;
         case Mul:
             return left * right;
+        case MulH:
+            return (int32_t)(((int64_t)left * (int64_t)right) >> 32);
+        case MulHSU:
+            return (int32_t)(((int64_t)left * (int64_t)(uint32_t)right) >> 32);
+        case MulHU:
+            return (int32_t)(((uint64_t)(uint32_t)left * (uint32_t)right) >> 32);
         case Div:
+            if (left == INT32_MIN && right == -1) return left; // Overflow would trap on the host
             return (right != 0) ? left / right : 0; // Avoid division by zero
         case DivU:
             return (right != 0) ? (uint32_t)left / (uint32_t)right : 0;
         case Rem:
+            if (left == INT32_MIN && right == -1) return 0;
             return (right != 0) ? left % right : 0;
         case RemU:
             return (right != 0) ? (uint32_t)left % (uint32_t)right : 0;
@@ -59,27 +68,32 @@ int should_branch(Instruction *inst, int32_t alu_result) {
 }
 
 void update_program_counter(VirtualMachine *vm, Instruction *inst, int32_t alu_result) {
+    uint32_t branch_pc = vm->program_counter - 4;
+
     switch (inst->type) {
         case B_TYPE: // Handle conditional branches
             if (should_branch(inst, alu_result)) {
                 vm->program_counter = (vm->program_counter - 4) + inst->disp_strval;
-                printf("Branch taken to PC: 0x%08X\n", vm->program_counter);
+                if (vm->trace) printf("Branch taken to PC: 0x%08X\n", vm->program_counter);
             } else {
-                printf("Branch not taken\n");
+                if (vm->trace) printf("Branch not taken\n");
             }
+            coverage_record_edge(branch_pc, vm->program_counter);
             break;
             
         case J_TYPE: // JAL (Jump and Link)
             if (inst->opcode == 0x6F) {
                 vm->program_counter = (vm->program_counter - 4) + inst->disp_strval;
-                printf("JAL to PC: 0x%08X\n", vm->program_counter);
+                if (vm->trace) printf("JAL to PC: 0x%08X\n", vm->program_counter);
+                coverage_record_edge(branch_pc, vm->program_counter);
             }
             break;
             
         case I_TYPE: // JALR (Jump and Link Register)
             if (inst->opcode == 0x67) {
                 vm->program_counter = alu_result & ~1; // Clear LSB as per RISC-V spec
-                printf("JALR to PC: 0x%08X\n", vm->program_counter);
+                if (vm->trace) printf("JALR to PC: 0x%08X\n", vm->program_counter);
+                coverage_record_edge(branch_pc, vm->program_counter);
             }
             break;
             
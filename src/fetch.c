@@ -23,10 +23,17 @@ int fetch(VirtualMachine *vm, Instruction *inst) {
     inst->rd = 0;
     inst->rs1 = 0;
     inst->rs2 = 0;
+    inst->reads = 0;
     inst->funct3 = 0;
     inst->funct7 = 0;
     inst->memop = 0;
     inst->aluop = 0;
-    inst->opcode = 0;   
+    inst->opcode = 0;
+    inst->fusion = 0;
+    inst->vd = 0;
+    inst->vreads = 0;
+    inst->vwrites = 0;
+    inst->handler = NULL;
+    inst->id = INST_UNSUPPORTED;
     return 0;
 }
\ No newline at end of file
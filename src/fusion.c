@@ -0,0 +1,104 @@
+#include "fusion.h"
+#include "isa.h"
+
+// Macro-op fusion. After the first instruction of a pair has been decoded,
+// the following word is inspected and, if the two form a known idiom, the
+// first Instruction is rewritten to perform both and the program counter is
+// advanced past the second. Every idiom writes a single destination register
+// whose intermediate value is overwritten by the second instruction, so the
+// fused result leaves exactly the architectural state the pair would have.
+// Fusion happens at decode time from the current PC, so a branch into the
+// middle of a pair simply decodes the second instruction on its own.
+
+static const char *fusion_names[] = {
+    "none", "lui+addi", "auipc+jalr", "auipc+load", "slt+branch", "zero-extend"
+};
+
+const char *fusion_name(uint8_t fusion) {
+    return fusion_names[fusion];
+}
+
+static int is_load(InstructionId id) {
+    return id < NUM_INSTRUCTIONS && instruction_table[id].memop == MEM_LOAD;
+}
+
+int fuse_instruction_pair(VirtualMachine *vm, Instruction *inst) {
+    if (!vm->fuse_instructions || inst->rd == 0) return 0;
+    if (vm->program_counter + 4 > SIZE_OF_MEMORY) return 0;
+
+    uint32_t next = *(uint32_t *)(vm->memory + vm->program_counter);
+    InstructionId next_id = lookup_instruction(next);
+    uint8_t next_rd = (next >> 7) & 0x1F;
+    uint8_t next_funct3 = (next >> 12) & 0x07;
+    uint8_t next_rs1 = (next >> 15) & 0x1F;
+    uint8_t next_rs2 = (next >> 20) & 0x1F;
+    int32_t next_imm = extend_sign_bit((next >> 20) & 0xFFF, 11);
+    uint8_t fusion = FUSION_NONE;
+
+    switch (inst->id) {
+        case INST_LUI:
+            if (next_id == INST_ADDI && next_rd == inst->rd && next_rs1 == inst->rd) {
+                inst->right += next_imm;
+                fusion = FUSION_LUI_ADDI;
+            }
+            break;
+
+        case INST_AUIPC:
+            if (next_rd != inst->rd || next_rs1 != inst->rd) break;
+            if (next_id == INST_JALR) {
+                // Becomes a JALR whose base register already holds PC + hi
+                inst->left += inst->right;
+                inst->right = next_imm;
+                inst->type = I_TYPE;
+                inst->opcode = 0x67;
+                inst->funct3 = next_funct3;
+                fusion = FUSION_AUIPC_JALR;
+            } else if (is_load(next_id)) {
+                inst->left += inst->right;
+                inst->right = next_imm;
+                inst->type = I_TYPE;
+                inst->opcode = 0x03;
+                inst->funct3 = next_funct3;
+                inst->memop = MEM_LOAD;
+                inst->handler = instruction_table[next_id].handler;
+                fusion = FUSION_AUIPC_LOAD;
+            }
+            break;
+
+        case INST_SLT:
+        case INST_SLTU:
+            if ((next_id == INST_BEQ || next_id == INST_BNE) &&
+                ((next_rs1 == inst->rd && next_rs2 == 0) || (next_rs1 == 0 && next_rs2 == inst->rd))) {
+                // The comparison result is still written to rd, and BEQ/BNE
+                // against zero is exactly what should_branch checks for
+                int32_t imm = ((next >> 31) & 0x1) << 12 |
+                              ((next >> 7) & 0x1) << 11 |
+                              ((next >> 25) & 0x3F) << 5 |
+                              ((next >> 8) & 0xF) << 1;
+                inst->type = B_TYPE;
+                inst->opcode = 0x63;
+                inst->funct3 = next_funct3;
+                inst->disp_strval = extend_sign_bit(imm, 12);
+                fusion = FUSION_SLT_BRANCH;
+            }
+            break;
+
+        case INST_SLLI:
+            if (next_id == INST_SRLI && next_rd == inst->rd && next_rs1 == inst->rd &&
+                ((next >> 20) & 0x1F) == inst->right) {
+                inst->aluop = And;
+                inst->right = 0xFFFFFFFFu >> inst->right;
+                fusion = FUSION_ZERO_EXTEND;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (fusion == FUSION_NONE) return 0;
+
+    inst->fusion = fusion;
+    vm->program_counter += 4;
+    return 1;
+}
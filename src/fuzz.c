@@ -0,0 +1,160 @@
+#include "fuzz.h"
+#include "coverage.h"
+#include "run.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// AFL forkserver pipes: afl-fuzz writes requests to FORKSRV_FD and reads
+// replies from FORKSRV_FD + 1.
+#define FORKSRV_FD 198
+
+// Guest calling convention for fuzzing: the program starts at its entry
+// point with a0 = address of the input buffer and a1 = input length, and
+// finishes with sys_exit. Bad memory accesses and unsupported instructions
+// are reported to AFL as crashes.
+
+typedef struct {
+    VirtualMachine state;
+    uint8_t *memory;
+} Snapshot;
+
+static void take_snapshot(Snapshot *snapshot, const VirtualMachine *vm) {
+    snapshot->state = *vm;
+    snapshot->memory = malloc(SIZE_OF_MEMORY);
+    memcpy(snapshot->memory, vm->memory, SIZE_OF_MEMORY);
+}
+
+// Only the pages written since the last restore are copied back
+static void restore_snapshot(VirtualMachine *vm, const Snapshot *snapshot) {
+    uint8_t *memory = vm->memory;
+    uint8_t *dirty_pages = vm->dirty_pages;
+    *vm = snapshot->state;
+    vm->memory = memory;
+    vm->dirty_pages = dirty_pages;
+
+    for (uint32_t page = 0; page < NUM_OF_PAGES; page++) {
+        if (!dirty_pages[page]) continue;
+        uint32_t offset = page << PAGE_SHIFT;
+        memcpy(memory + offset, snapshot->memory + offset, PAGE_SIZE);
+        dirty_pages[page] = 0;
+    }
+}
+
+static uint32_t load_input(VirtualMachine *vm, const FuzzOptions *options) {
+    uint8_t *buffer = vm->memory + options->buffer_address;
+    ssize_t length;
+
+    if (options->input_path) {
+        FILE *file = fopen(options->input_path, "rb");
+        if (!file) return 0;
+        length = fread(buffer, 1, options->buffer_size, file);
+        fclose(file);
+    } else {
+        // afl-fuzz rewrites the same stdin file for every test case
+        lseek(STDIN_FILENO, 0, SEEK_SET);
+        length = read(STDIN_FILENO, buffer, options->buffer_size);
+        if (length < 0) length = 0;
+    }
+
+    if (length > 0) {
+        uint32_t last = options->buffer_address + (uint32_t)length - 1;
+        for (uint32_t page = options->buffer_address >> PAGE_SHIFT; page <= last >> PAGE_SHIFT; page++) {
+            vm->dirty_pages[page] = 1;
+        }
+    }
+
+    write_to_register(vm, 10, options->buffer_address); // a0
+    write_to_register(vm, 11, (uint32_t)length);         // a1
+    return (uint32_t)length;
+}
+
+static int run_one_input(VirtualMachine *vm, const Snapshot *snapshot, const FuzzOptions *options, int restore) {
+    if (restore) restore_snapshot(vm, snapshot);
+    load_input(vm, options);
+    run_machine(vm, options->max_instructions);
+
+    if (vm->state == VM_FAULT) {
+        // Make AFL see a crash rather than a plain non-zero exit
+        abort();
+    }
+    return vm->exit_code;
+}
+
+// Child side of the forkserver: in persistent mode the child runs several
+// inputs, stopping itself after each so the forkserver can report the result
+// and resume it with SIGCONT instead of forking again.
+static void run_child(VirtualMachine *vm, const Snapshot *snapshot, const FuzzOptions *options) {
+    int exit_code = 0;
+
+    close(FORKSRV_FD);
+    close(FORKSRV_FD + 1);
+
+    for (uint32_t i = 0; i < options->persistent_iterations; i++) {
+        if (i > 0) raise(SIGSTOP);
+        // A freshly forked child already holds the pristine image
+        exit_code = run_one_input(vm, snapshot, options, i > 0);
+    }
+    _exit(exit_code);
+}
+
+int run_fuzzer(VirtualMachine *vm, const FuzzOptions *options) {
+    if (options->buffer_address >= SIZE_OF_MEMORY ||
+        options->buffer_size > SIZE_OF_MEMORY - options->buffer_address) {
+        fprintf(stderr, "Fuzz input buffer does not fit into memory\n");
+        return -1;
+    }
+
+    if (initialize_coverage() != 0) return -1;
+
+    vm->dirty_pages = calloc(NUM_OF_PAGES, 1);
+    Snapshot snapshot;
+    take_snapshot(&snapshot, vm);
+
+    // Say hello to afl-fuzz; without it, just run the single input
+    uint32_t message = 0;
+    if (write(FORKSRV_FD + 1, &message, 4) != 4) {
+        int exit_code = run_one_input(vm, &snapshot, options, 0);
+        free(snapshot.memory);
+        free(vm->dirty_pages);
+        vm->dirty_pages = NULL;
+        return exit_code;
+    }
+
+    pid_t child = -1;
+    int child_stopped = 0;
+
+    while (1) {
+        uint32_t was_killed;
+        if (read(FORKSRV_FD, &was_killed, 4) != 4) break;
+
+        // A stopped persistent child that afl-fuzz killed on timeout must be reaped
+        if (child_stopped && was_killed) {
+            child_stopped = 0;
+            waitpid(child, NULL, 0);
+        }
+
+        if (!child_stopped) {
+            child = fork();
+            if (child < 0) break;
+            if (child == 0) run_child(vm, &snapshot, options);
+        } else {
+            kill(child, SIGCONT);
+            child_stopped = 0;
+        }
+
+        int status;
+        if (write(FORKSRV_FD + 1, &child, 4) != 4) break;
+        if (waitpid(child, &status, options->persistent_iterations > 1 ? WUNTRACED : 0) < 0) break;
+        if (WIFSTOPPED(status)) child_stopped = 1;
+        if (write(FORKSRV_FD + 1, &status, 4) != 4) break;
+    }
+
+    free(snapshot.memory);
+    free(vm->dirty_pages);
+    vm->dirty_pages = NULL;
+    return 0;
+}
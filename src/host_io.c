@@ -0,0 +1,45 @@
+#include "host_io.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// a0 = fd, a1 = buffer, a2 = count. Returns the byte count or -errno in a0.
+void host_file_syscall(VirtualMachine *vm, uint32_t number) {
+    uint32_t fd = vm->registers[10];
+    uint32_t buffer = vm->registers[11];
+    uint32_t count = vm->registers[12];
+    int is_write = number == 64;
+
+    if (fd >= NUM_GUEST_FILES || vm->host_files[fd] < 0) {
+        vm->registers[10] = (uint32_t)-EBADF;
+        return;
+    }
+    if (buffer > SIZE_OF_MEMORY || count > SIZE_OF_MEMORY - buffer) {
+        vm->registers[10] = (uint32_t)-EFAULT;
+        return;
+    }
+
+    int host_fd = vm->host_files[fd];
+    ssize_t done = is_write ? write(host_fd, vm->memory + buffer, count)
+                            : read(host_fd, vm->memory + buffer, count);
+
+    if (done < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // Nothing retires: the ECALL runs again when the machine resumes
+        vm->state = VM_BLOCKED;
+        vm->wait_fd = host_fd;
+        vm->wait_events = is_write ? EPOLLOUT : EPOLLIN;
+        vm->program_counter -= 4;
+        return;
+    }
+    if (done < 0) {
+        vm->registers[10] = (uint32_t)-errno;
+        return;
+    }
+
+    if (!is_write && vm->dirty_pages && done > 0) {
+        for (uint32_t page = buffer >> PAGE_SHIFT; page <= (buffer + done - 1) >> PAGE_SHIFT; page++) {
+            vm->dirty_pages[page] = 1;
+        }
+    }
+    vm->registers[10] = (uint32_t)done;
+}
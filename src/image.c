@@ -0,0 +1,57 @@
+#define _GNU_SOURCE
+#include "image.h"
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+int create_guest_image(GuestImage *image, const char *filename) {
+    image->fd = memfd_create("riscv-guest-image", MFD_CLOEXEC);
+    if (image->fd < 0) {
+        perror("memfd_create");
+        return -1;
+    }
+
+    if (ftruncate(image->fd, SIZE_OF_MEMORY) != 0) {
+        perror("ftruncate");
+        close(image->fd);
+        return -1;
+    }
+
+    uint8_t *memory = mmap(NULL, SIZE_OF_MEMORY, PROT_READ | PROT_WRITE, MAP_SHARED, image->fd, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        close(image->fd);
+        return -1;
+    }
+
+    // Load ELF file and validate
+    ELFHeader elf_header;
+    int status = load_elf_file(filename, memory, SIZE_OF_MEMORY, &image->entry, &elf_header);
+    if (status == 0) status = check_elf_file(&elf_header);
+
+    munmap(memory, SIZE_OF_MEMORY);
+    if (status != 0) {
+        close(image->fd);
+        return -1;
+    }
+    return 0;
+}
+
+int initialize_machine_from_image(VirtualMachine *vm, const GuestImage *image) {
+    initialize_machine_state(vm);
+
+    uint8_t *memory = mmap(NULL, SIZE_OF_MEMORY, PROT_READ | PROT_WRITE, MAP_PRIVATE, image->fd, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    vm->memory = memory;
+    vm->memory_mapped = 1;
+    vm->program_counter = image->entry;
+    return 0;
+}
+
+void free_guest_image(GuestImage *image) {
+    close(image->fd);
+}
@@ -0,0 +1,200 @@
+#include "interval.h"
+#include "run.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Interval simulation. A fast functional pass runs the whole program once,
+// recording an architectural checkpoint every interval_length instructions:
+// the scalar and vector registers, the program counter, the CSR state and
+// the pages stored to since the previous checkpoint. The intervals are then
+// replayed with the timing model attached on a pool of threads, and their
+// statistics are summed.
+//
+// A replayed interval starts with an empty pipeline, so a load-use hazard
+// that straddles two intervals is not counted. The report therefore
+// undercounts by at most one LOAD_USE_PENALTY stall per interval boundary.
+
+typedef struct {
+    uint32_t registers[NUM_OF_REGISTERS];
+    uint32_t program_counter;
+    uint64_t retired_instructions;  // Read back by instret, time and (untimed) cycle
+    uint32_t mstatus, mie, mip, mtvec, mepc, mcause, mscratch;
+    uint32_t vl, vtype;
+    uint8_t vregs[VECTOR_REGISTER_BYTES];
+    uint64_t length;            // Instructions retired from here to the next checkpoint
+    uint32_t num_pages;
+    uint16_t *page_numbers;     // Pages stored to during the previous interval
+    uint8_t *page_data;         // Their contents at this checkpoint
+} Checkpoint;
+
+typedef struct {
+    uint8_t *base_memory;
+    Checkpoint *checkpoints;
+    size_t num_checkpoints;
+    TimingModel *results;
+    size_t next_interval;
+    pthread_mutex_t lock;
+} IntervalSimulation;
+
+static void record_checkpoint(Checkpoint *checkpoint, VirtualMachine *vm) {
+    memcpy(checkpoint->registers, vm->registers, sizeof(vm->registers));
+    checkpoint->program_counter = vm->program_counter;
+    checkpoint->retired_instructions = vm->retired_instructions;
+    checkpoint->mstatus = vm->mstatus;
+    checkpoint->mie = vm->mie;
+    checkpoint->mip = vm->mip;
+    checkpoint->mtvec = vm->mtvec;
+    checkpoint->mepc = vm->mepc;
+    checkpoint->mcause = vm->mcause;
+    checkpoint->mscratch = vm->mscratch;
+    checkpoint->vl = vm->vl;
+    checkpoint->vtype = vm->vtype;
+    memcpy(checkpoint->vregs, vm->vregs, sizeof(checkpoint->vregs));
+    checkpoint->length = 0;
+
+    checkpoint->num_pages = 0;
+    for (uint32_t page = 0; page < NUM_OF_PAGES; page++) {
+        checkpoint->num_pages += vm->dirty_pages[page];
+    }
+
+    checkpoint->page_numbers = malloc(checkpoint->num_pages * sizeof(uint16_t));
+    checkpoint->page_data = malloc((size_t)checkpoint->num_pages * PAGE_SIZE);
+
+    uint32_t index = 0;
+    for (uint32_t page = 0; page < NUM_OF_PAGES; page++) {
+        if (!vm->dirty_pages[page]) continue;
+        checkpoint->page_numbers[index] = (uint16_t)page;
+        memcpy(checkpoint->page_data + (size_t)index * PAGE_SIZE, vm->memory + (page << PAGE_SHIFT), PAGE_SIZE);
+        vm->dirty_pages[page] = 0;
+        index++;
+    }
+}
+
+static void apply_checkpoint_pages(uint8_t *memory, const Checkpoint *checkpoint) {
+    for (uint32_t i = 0; i < checkpoint->num_pages; i++) {
+        memcpy(memory + (checkpoint->page_numbers[i] << PAGE_SHIFT),
+               checkpoint->page_data + (size_t)i * PAGE_SIZE, PAGE_SIZE);
+    }
+}
+
+static void *interval_worker(void *argument) {
+    IntervalSimulation *simulation = argument;
+    VirtualMachine vm;
+    TimingModel model;
+
+    initialize_machine(&vm);
+    vm.trace = 0;
+    vm.replay = 1;
+    vm.fuse_instructions = 0;
+    vm.timing = &model;
+    memcpy(vm.memory, simulation->base_memory, SIZE_OF_MEMORY);
+
+    // Intervals are handed out in order, so this worker's memory only ever
+    // has to move forward: it holds the state at checkpoint memory_state
+    size_t memory_state = 0;
+
+    while (1) {
+        pthread_mutex_lock(&simulation->lock);
+        size_t interval = simulation->next_interval++;
+        pthread_mutex_unlock(&simulation->lock);
+        if (interval >= simulation->num_checkpoints) break;
+
+        for (size_t i = memory_state + 1; i <= interval; i++) {
+            apply_checkpoint_pages(vm.memory, &simulation->checkpoints[i]);
+        }
+
+        const Checkpoint *checkpoint = &simulation->checkpoints[interval];
+        memcpy(vm.registers, checkpoint->registers, sizeof(vm.registers));
+        vm.program_counter = checkpoint->program_counter;
+        vm.retired_instructions = checkpoint->retired_instructions;
+        vm.mstatus = checkpoint->mstatus;
+        vm.mie = checkpoint->mie;
+        vm.mip = checkpoint->mip;
+        vm.mtvec = checkpoint->mtvec;
+        vm.mepc = checkpoint->mepc;
+        vm.mcause = checkpoint->mcause;
+        vm.mscratch = checkpoint->mscratch;
+        vm.vl = checkpoint->vl;
+        vm.vtype = checkpoint->vtype;
+        memcpy(vm.vregs, checkpoint->vregs, sizeof(checkpoint->vregs));
+        vm.state = VM_RUNNING;
+
+        initialize_timing_model(&model);
+        run_machine(&vm, checkpoint->length);
+        simulation->results[interval] = model;
+
+        // Replaying the interval left memory exactly as the next checkpoint saw it
+        memory_state = interval + 1;
+    }
+
+    free_machine(&vm);
+    return NULL;
+}
+
+// Runs the program to completion and fills total with the stitched timing
+// statistics. Returns the number of instructions retired.
+uint64_t run_interval_simulation(VirtualMachine *vm, const IntervalOptions *options, TimingModel *total) {
+    IntervalSimulation simulation;
+    size_t capacity = 16;
+
+    simulation.base_memory = malloc(SIZE_OF_MEMORY);
+    memcpy(simulation.base_memory, vm->memory, SIZE_OF_MEMORY);
+    simulation.checkpoints = malloc(capacity * sizeof(Checkpoint));
+    simulation.num_checkpoints = 0;
+    simulation.next_interval = 0;
+    pthread_mutex_init(&simulation.lock, NULL);
+
+    // Functional pass
+    vm->dirty_pages = calloc(NUM_OF_PAGES, 1);
+    vm->fuse_instructions = 0;
+    uint64_t retired = 0;
+
+    while (vm->state == VM_RUNNING && retired < options->max_instructions) {
+        if (simulation.num_checkpoints == capacity) {
+            capacity *= 2;
+            simulation.checkpoints = realloc(simulation.checkpoints, capacity * sizeof(Checkpoint));
+        }
+
+        Checkpoint *checkpoint = &simulation.checkpoints[simulation.num_checkpoints++];
+        record_checkpoint(checkpoint, vm);
+
+        uint64_t length = options->max_instructions - retired;
+        if (length > options->interval_length) length = options->interval_length;
+        checkpoint->length = run_machine(vm, length);
+        retired += checkpoint->length;
+    }
+
+    free(vm->dirty_pages);
+    vm->dirty_pages = NULL;
+
+    // Detailed pass
+    simulation.results = calloc(simulation.num_checkpoints, sizeof(TimingModel));
+    int num_threads = options->num_threads > 0 ? options->num_threads : 1;
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, interval_worker, &simulation);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    initialize_timing_model(total);
+    for (size_t i = 0; i < simulation.num_checkpoints; i++) {
+        merge_timing_model(total, &simulation.results[i]);
+        free(simulation.checkpoints[i].page_numbers);
+        free(simulation.checkpoints[i].page_data);
+    }
+
+    printf("Interval simulation: %zu intervals of up to %llu instructions on %d threads\n",
+           simulation.num_checkpoints, (unsigned long long)options->interval_length, num_threads);
+
+    free(threads);
+    free(simulation.results);
+    free(simulation.checkpoints);
+    free(simulation.base_memory);
+    pthread_mutex_destroy(&simulation.lock);
+    return retired;
+}
@@ -0,0 +1,115 @@
+#include "isa.h"
+#include "memory.h"     // Handlers named in isa.def
+#include "csr.h"
+#include "vector.h"
+
+const InstructionInfo instruction_table[NUM_INSTRUCTIONS] = {
+#define INSTRUCTION(id, mnemonic, mask, match, format, aluop, memop, handler, latency) \
+    { mnemonic, mask, match, format, aluop, memop, handler, latency },
+#include "isa.def"
+#undef INSTRUCTION
+};
+
+// Two-level lookup: opcode and funct3 select a slot, and each slot lists the
+// table entries that can match in that slot. Most slots hold exactly one
+// candidate, so the mask/match loop below normally runs once. Slots with
+// more than SPLIT_THRESHOLD candidates (the OP-V arithmetic slots, where
+// dozens of operations share opcode and funct3) get a third level indexed
+// by funct6, bits 31:26, with a short candidate list per value.
+#define NUM_SLOTS (128 * 8)
+#define SPLIT_THRESHOLD 4
+#define MAX_SPLIT_SLOTS 16
+#define NUM_FUNCT6 64
+#define MAX_CANDIDATES (NUM_INSTRUCTIONS * 8 + MAX_SPLIT_SLOTS * NUM_FUNCT6 * SPLIT_THRESHOLD)
+
+// Candidate ids are uint16_t, so the table can grow well past 256 entries
+_Static_assert(NUM_INSTRUCTIONS < 65536, "instruction ids must fit in uint16_t");
+_Static_assert(MAX_CANDIDATES < 65536, "candidate offsets must fit in uint16_t");
+
+static uint16_t slot_start[NUM_SLOTS];
+static uint16_t slot_count[NUM_SLOTS];
+static uint8_t slot_split[NUM_SLOTS];      // 1 + index into the funct6 tables, or 0
+static uint16_t split_start[MAX_SPLIT_SLOTS][NUM_FUNCT6];
+static uint16_t split_count[MAX_SPLIT_SLOTS][NUM_FUNCT6];
+static uint16_t candidates[MAX_CANDIDATES];
+static int decoder_initialized = 0;
+
+static uint32_t get_slot(uint32_t instruction) {
+    return ((instruction & 0x7F) << 3) | ((instruction >> 12) & 0x07);
+}
+
+// Appends the entries of list that can match the given instruction bits
+// under mask, returning the new end of the candidate array
+static uint16_t add_candidates(uint16_t next, const uint16_t *list, uint16_t count, uint32_t bits, uint32_t mask) {
+    for (uint16_t i = 0; i < count; i++) {
+        const InstructionInfo *info = &instruction_table[list[i]];
+        if (((bits ^ info->match) & info->mask & mask) == 0) {
+            candidates[next++] = list[i];
+        }
+    }
+    return next;
+}
+
+// Builds the funct6 level of a slot from its candidates, returning the new
+// end of the candidate array. Leaves the slot flat if the lists do not fit.
+static uint16_t split_slot(uint32_t slot, uint16_t next, int split) {
+    const uint16_t *list = &candidates[slot_start[slot]];
+    uint16_t count = slot_count[slot];
+    uint16_t end = next;
+
+    for (uint32_t funct6 = 0; funct6 < NUM_FUNCT6; funct6++) {
+        if (end + count > MAX_CANDIDATES) return next;
+        split_start[split][funct6] = end;
+        end = add_candidates(end, list, count, funct6 << 26, 0xFC000000u);
+        split_count[split][funct6] = (uint16_t)(end - split_start[split][funct6]);
+    }
+    slot_split[slot] = (uint8_t)(split + 1);
+    return end;
+}
+
+void initialize_decoder(void) {
+    if (decoder_initialized) return;
+
+    uint16_t all[NUM_INSTRUCTIONS];
+    for (int id = 0; id < NUM_INSTRUCTIONS; id++) all[id] = (uint16_t)id;
+
+    uint16_t next = 0;
+    for (uint32_t slot = 0; slot < NUM_SLOTS; slot++) {
+        // Rebuild the opcode and funct3 bits this slot stands for
+        uint32_t bits = ((slot >> 3) & 0x7F) | ((slot & 0x07) << 12);
+        slot_start[slot] = next;
+        next = add_candidates(next, all, NUM_INSTRUCTIONS, bits, 0x707F);
+        slot_count[slot] = (uint16_t)(next - slot_start[slot]);
+    }
+
+    int num_split = 0;
+    for (uint32_t slot = 0; slot < NUM_SLOTS && num_split < MAX_SPLIT_SLOTS; slot++) {
+        if (slot_count[slot] <= SPLIT_THRESHOLD) continue;
+        next = split_slot(slot, next, num_split);
+        if (slot_split[slot]) num_split++;
+    }
+
+    decoder_initialized = 1;
+}
+
+InstructionId lookup_instruction(uint32_t instruction) {
+    uint32_t slot = get_slot(instruction);
+    uint32_t start = slot_start[slot];
+    uint32_t count = slot_count[slot];
+
+    if (slot_split[slot]) {
+        uint32_t split = slot_split[slot] - 1;
+        uint32_t funct6 = instruction >> 26;
+        start = split_start[split][funct6];
+        count = split_count[split][funct6];
+    }
+
+    const uint16_t *candidate = &candidates[start];
+    for (uint32_t i = 0; i < count; i++) {
+        const InstructionInfo *info = &instruction_table[candidate[i]];
+        if ((instruction & info->mask) == info->match) {
+            return (InstructionId)candidate[i];
+        }
+    }
+    return INST_UNSUPPORTED;
+}
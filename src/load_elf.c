@@ -0,0 +1,65 @@
+#include "load_elf.h"
+#include <stdio.h>
+#include <string.h>
+
+int load_elf_file(const char *filename, uint8_t *memory, uint32_t memory_size, uint32_t *program_counter, ELFHeader *elf_header) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Could not open file %s\n", filename);
+        return -1;
+    }
+
+    if (fread(elf_header, 1, sizeof(ELFHeader), file) != sizeof(ELFHeader)) {
+        fprintf(stderr, "Could not read ELF Header\n");
+        fclose(file);
+        return -1;
+    }
+
+    for (int i = 0; i < elf_header->e_phnum; i++) {
+        // Segment loading moves the file position, so seek to each header
+        ELFProgramHeader program_header;
+        fseek(file, elf_header->e_phoff + i * elf_header->e_phentsize, SEEK_SET);
+        if (fread(&program_header, 1, sizeof(ELFProgramHeader), file) != sizeof(ELFProgramHeader)) {
+            fprintf(stderr, "Could not read program header\n");
+            fclose(file);
+            return -1;
+        }
+
+        if (program_header.p_type == PT_LOAD) {
+            if (program_header.p_vaddr + program_header.p_memsz > memory_size) {
+                fprintf(stderr, "Program header does not fit into memory\n");
+                fclose(file);
+                return -1;
+            }
+
+            fseek(file, program_header.p_offset, SEEK_SET);
+            if (fread(memory + program_header.p_vaddr, 1, program_header.p_filesz, file) != program_header.p_filesz) {
+                fprintf(stderr, "Could not read program segment\n");
+                fclose(file);
+                return -1;
+            }
+
+            if (program_header.p_memsz > program_header.p_filesz) {
+                memset(memory + program_header.p_vaddr + program_header.p_filesz, 0, program_header.p_memsz - program_header.p_filesz);
+            }
+        }
+    }
+
+    *program_counter = elf_header->e_entry;
+    fclose(file);
+    return 0;
+}
+
+int check_elf_file(const ELFHeader *elf_header) {
+    if (memcmp(elf_header->e_ident, "\x7f""ELF", 4) != 0) {
+        fprintf(stderr, "e_ident value is not valid\n");
+        return -1;
+    }
+
+    if (elf_header->e_type != ET_EXEC || elf_header->e_machine != EM_RISCV) {
+        fprintf(stderr, "Invalid ELF file for this machine\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -1,16 +1,57 @@
 #include "machine.h"
+#include "vector.h"
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
-void initialize_machine(VirtualMachine *vm) {
+// Resets everything except the memory block
+void initialize_machine_state(VirtualMachine *vm) {
     memset(vm->registers, 0, sizeof(vm->registers));
     vm->program_counter = 0;
+    vm->fuse_instructions = 1;
+    vm->trace = 1;
+    vm->state = VM_RUNNING;
+    vm->exit_code = 0;
+    vm->retired_instructions = 0;
+    vm->timing = NULL;
+    vm->ooo = NULL;
+    vm->dirty_pages = NULL;
+    vm->replay = 0;
+    vm->bus = NULL;
+    vm->clint = NULL;
+    vm->block_start = 1;
+    vm->instruction_plugins = 0;
+    vm->memory_plugins = 0;
+    vm->host_files = NULL;
+    vm->wait_fd = -1;
+    vm->wait_events = 0;
+    vm->mstatus = 0;
+    vm->mie = 0;
+    vm->mip = 0;
+    vm->mtvec = 0;
+    vm->mepc = 0;
+    vm->mcause = 0;
+    vm->mscratch = 0;
+    vm->vl = 0;
+    vm->vtype = VTYPE_VILL;
+    memset(vm->vregs, 0, sizeof(vm->vregs));
+    vm->memory = NULL;
+    vm->memory_mapped = 0;
+}
+
+void initialize_machine(VirtualMachine *vm) {
+    initialize_machine_state(vm);
     vm->memory = malloc(SIZE_OF_MEMORY);
     memset(vm->memory, 0, SIZE_OF_MEMORY);
 }
 
 void free_machine(VirtualMachine *vm) {
-    free(vm->memory);
+    if (vm->memory_mapped) {
+        munmap(vm->memory, SIZE_OF_MEMORY);
+    } else {
+        free(vm->memory);
+    }
+    vm->memory = NULL;
 }
 
 int32_t extend_sign_bit(int32_t value, uint8_t sign_bit_location) {
@@ -1,113 +1,177 @@
 #include "memory.h"
 #include "machine.h"    // For VirtualMachine, SIZE_OF_MEMORY
 #include "fetch.h"      // For Instruction struct
+#include "bus.h"
+#include "trap.h"
+#include "host_io.h"
+#include "plugin.h"
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>     // For uint32_t, int32_t, uint8_t, etc.
 
-void memory_stage(VirtualMachine *vm, Instruction *inst, int32_t *result) {
+static void memory_fault(VirtualMachine *vm, uint32_t address) {
+    fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
+    vm->state = VM_FAULT;
+    vm->exit_code = 1;
+}
+
+// Loads and stores outside RAM go to the device bus
+static void device_load(VirtualMachine *vm, const Instruction *inst, uint32_t address, int32_t *result) {
+    uint8_t width = 1 << (inst->funct3 & 0x3);
+    uint32_t value;
+
+    if (!vm->bus || bus_read(vm->bus, address, width, &value) != 0) {
+        memory_fault(vm, address);
+        return;
+    }
+
+    switch (inst->funct3) {
+        case 0: *result = (int8_t)value; break;     // LB
+        case 1: *result = (int16_t)value; break;    // LH
+        case 4: *result = (uint8_t)value; break;    // LBU
+        case 5: *result = (uint16_t)value; break;   // LHU
+        default: *result = (int32_t)value; break;   // LW
+    }
+}
+
+static void device_store(VirtualMachine *vm, const Instruction *inst, uint32_t address) {
+    uint8_t width = 1 << (inst->funct3 & 0x3);
+
+    if (!vm->bus || bus_write(vm->bus, address, width, inst->disp_strval) != 0) {
+        memory_fault(vm, address);
+    }
+}
+
+// Loads: the execute stage left the effective address in result
+void execute_load(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
     uint32_t address = (uint32_t)(*result);
-    
-    // Check memory bounds before accessing
-    if (address >= SIZE_OF_MEMORY) {
-        fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
-        exit(1);
+
+    // RAM fast path: a single range check covering the whole access
+    uint32_t width = 1 << (inst->funct3 & 0x3);
+    if (address > SIZE_OF_MEMORY - width) {
+        device_load(vm, inst, address, result);
+        return;
     }
-    
-    if (inst->memop == 1) { // LOAD operation
-        switch (inst->funct3) {
-            case 0: { // LB (Load Byte)
-                int8_t value = (int8_t)vm->memory[address];
-                *result = (int32_t)value;
-                break;
-            }
-            case 1: { // LH (Load Halfword)
-                if (address + 1 >= SIZE_OF_MEMORY) {
-                    fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
-                    exit(1);
-                }
-                int16_t value;
-                memcpy(&value, &vm->memory[address], sizeof(int16_t));
-                *result = (int32_t)value;
-                break;
-            }
-            case 2: { // LW (Load Word)
-                if (address + 3 >= SIZE_OF_MEMORY) {
-                    fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
-                    exit(1);
-                }
-                int32_t value;
-                memcpy(&value, &vm->memory[address], sizeof(int32_t));
-                *result = value;
-                break;
-            }
-            case 4: { // LBU (Load Byte Unsigned)
-                uint8_t value = vm->memory[address];
-                *result = (int32_t)value;
-                break;
-            }
-            case 5: { // LHU (Load Halfword Unsigned)
-                if (address + 1 >= SIZE_OF_MEMORY) {
-                    fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
-                    exit(1);
-                }
-                uint16_t value;
-                memcpy(&value, &vm->memory[address], sizeof(uint16_t));
-                *result = (int32_t)value;
-                break;
-            }
-            default:
-                fprintf(stderr, "Unsupported LOAD funct3: %u\n", inst->funct3);
-                break;
+
+    switch (inst->funct3) {
+        case 0: { // LB (Load Byte)
+            int8_t value = (int8_t)vm->memory[address];
+            *result = (int32_t)value;
+            break;
         }
-    } else if (inst->memop == 2) { // STORE operation
-        switch (inst->funct3) {
-            case 0: { // SB (Store Byte)
-                uint8_t value = (uint8_t)(inst->disp_strval);
-                vm->memory[address] = value;
-                break;
-            }
-            case 1: { // SH (Store Halfword)
-                if (address + 1 >= SIZE_OF_MEMORY) {
-                    fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
-                    exit(1);
-                }
-                uint16_t value = (uint16_t)(inst->disp_strval);
-                memcpy(&vm->memory[address], &value, sizeof(uint16_t));
-                break;
-            }
-            case 2: { // SW (Store Word)
-                if (address + 3 >= SIZE_OF_MEMORY) {
-                    fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
-                    exit(1);
-                }
-                uint32_t value = (uint32_t)(inst->disp_strval);
-                memcpy(&vm->memory[address], &value, sizeof(uint32_t));
-                break;
-            }
-            default:
-                fprintf(stderr, "Unsupported STORE funct3: %u\n", inst->funct3);
-                break;
+        case 1: { // LH (Load Halfword)
+            int16_t value;
+            memcpy(&value, &vm->memory[address], sizeof(int16_t));
+            *result = (int32_t)value;
+            break;
+        }
+        case 2: { // LW (Load Word)
+            int32_t value;
+            memcpy(&value, &vm->memory[address], sizeof(int32_t));
+            *result = value;
+            break;
+        }
+        case 4: { // LBU (Load Byte Unsigned)
+            uint8_t value = vm->memory[address];
+            *result = (int32_t)value;
+            break;
+        }
+        case 5: { // LHU (Load Halfword Unsigned)
+            uint16_t value;
+            memcpy(&value, &vm->memory[address], sizeof(uint16_t));
+            *result = (int32_t)value;
+            break;
         }
-    } else if (inst->memop == 3) { // ECALL (System call)
-        // Handle system calls based on register a7 (x17)
-        uint32_t syscall_num = vm->registers[17]; // a7 register
-        switch (syscall_num) {
-            case 93: // sys_exit
+        default:
+            fprintf(stderr, "Unsupported LOAD funct3: %u\n", inst->funct3);
+            break;
+    }
+}
+
+// Stores: result holds the effective address and disp_strval the data
+void execute_store(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
+    uint32_t address = (uint32_t)(*result);
+    uint32_t width = 1 << (inst->funct3 & 0x3);
+    if (address > SIZE_OF_MEMORY - width) {
+        device_store(vm, inst, address);
+        return;
+    }
+
+    switch (inst->funct3) {
+        case 0: { // SB (Store Byte)
+            uint8_t value = (uint8_t)(inst->disp_strval);
+            vm->memory[address] = value;
+            break;
+        }
+        case 1: { // SH (Store Halfword)
+            uint16_t value = (uint16_t)(inst->disp_strval);
+            memcpy(&vm->memory[address], &value, sizeof(uint16_t));
+            break;
+        }
+        case 2: { // SW (Store Word)
+            uint32_t value = (uint32_t)(inst->disp_strval);
+            memcpy(&vm->memory[address], &value, sizeof(uint32_t));
+            break;
+        }
+        default:
+            fprintf(stderr, "Unsupported STORE funct3: %u\n", inst->funct3);
+            break;
+    }
+
+    // Record the pages written for checkpoint deltas and fuzz snapshot restores
+    if (vm->dirty_pages) {
+        vm->dirty_pages[address >> PAGE_SHIFT] = 1;
+        vm->dirty_pages[(address + width - 1) >> PAGE_SHIFT] = 1;
+    }
+}
+
+void execute_ecall(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
+    // Handle system calls based on register a7 (x17)
+    uint32_t syscall_num = vm->registers[17]; // a7 register
+    if (plugin_events & PLUGIN_EVENT_SYSCALL) plugin_syscall(vm, syscall_num);
+    switch (syscall_num) {
+        case 93: // sys_exit
+            if (vm->trace) {
                 printf("Program terminated via ECALL (exit code: %d)\n", (int32_t)vm->registers[10]); // a0 register
-                exit((int)vm->registers[10]);
-                break;
-            case 64: // sys_write
+            }
+            vm->state = VM_EXITED;
+            vm->exit_code = (int32_t)vm->registers[10];
+            break;
+        case 63: // sys_read
+            if (vm->host_files) {
+                host_file_syscall(vm, syscall_num);
+            } else if (!vm->replay) {
+                printf("Unsupported system call: %u\n", syscall_num);
+            }
+            break;
+        case 64: // sys_write
+            if (vm->host_files) {
+                host_file_syscall(vm, syscall_num);
+            } else if (!vm->replay) {
                 // Simple implementation - just print to stdout
                 printf("ECALL write: %d\n", (int32_t)vm->registers[10]);
-                break;
-            default:
-                printf("Unsupported system call: %u\n", syscall_num);
-                break;
-        }
-    } else if (inst->memop == 4) { // EBREAK
+            }
+            break;
+        default:
+            if (!vm->replay) printf("Unsupported system call: %u\n", syscall_num);
+            break;
+    }
+}
+
+void execute_ebreak(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
+    if (vm->trace) {
         printf("EBREAK encountered - stopping execution\n");
-        exit(0);
     }
+    vm->state = VM_STOPPED;
+}
+
+void execute_mret(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
+    return_from_trap(vm);
+}
+
+// Everything beyond the ALU operation is done by the handler isa.def names
+// for the instruction: loads and stores, ECALL/EBREAK/MRET, CSR access and
+// vector instructions.
+void memory_stage(VirtualMachine *vm, Instruction *inst, int32_t *result) {
+    if (inst->handler) inst->handler(vm, inst, result);
 }
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include "ooo.h"
+#include "isa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *unit_names[NUM_FU_CLASSES] = { "alu", "mul", "div", "mem" };
+
+static const char *stall_names[NUM_STALL_REASONS] = {
+    "Branch mispredict", "Serialization", "ROB full", "IQ full", "LSQ full"
+};
+
+void default_ooo_config(OooConfig *config) {
+    config->width = 4;
+    config->rob_size = 128;
+    config->iq_size = 48;
+    config->lsq_size = 48;
+    config->units[FU_ALU] = 4;
+    config->units[FU_MUL] = 1;
+    config->units[FU_DIV] = 1;
+    config->units[FU_MEM] = 2;
+    config->mispredict_penalty = 10;
+    config->predictor_bits = 12;
+}
+
+// Applies comma-separated key=value overrides such as "width=8,rob=256,alu=6".
+// "default" or an empty string keeps the defaults.
+int parse_ooo_config(OooConfig *config, const char *options) {
+    if (strcmp(options, "default") == 0) return 0;
+
+    char *copy = strdup(options);
+    char *saveptr = NULL;
+    int status = 0;
+
+    for (char *option = strtok_r(copy, ",", &saveptr); option; option = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(option, '=');
+        char *end = NULL;
+        unsigned long number = value ? strtoul(value + 1, &end, 0) : 0;
+        if (!value || end == value + 1 || *end != '\0' || number == 0 || number > 1 << 16) {
+            fprintf(stderr, "Invalid out-of-order option: %s\n", option);
+            status = -1;
+            break;
+        }
+        *value = '\0';
+
+        uint32_t *field = NULL;
+        if (strcmp(option, "width") == 0) field = &config->width;
+        else if (strcmp(option, "rob") == 0) field = &config->rob_size;
+        else if (strcmp(option, "iq") == 0) field = &config->iq_size;
+        else if (strcmp(option, "lsq") == 0) field = &config->lsq_size;
+        else if (strcmp(option, "penalty") == 0) field = &config->mispredict_penalty;
+        else if (strcmp(option, "bpred") == 0 && number <= 24) field = &config->predictor_bits;
+        for (int i = 0; i < NUM_FU_CLASSES && !field; i++) {
+            if (strcmp(option, unit_names[i]) == 0) field = &config->units[i];
+        }
+
+        if (!field) {
+            fprintf(stderr, "Unknown out-of-order option: %s\n", option);
+            status = -1;
+            break;
+        }
+        *field = (uint32_t)number;
+    }
+
+    free(copy);
+    return status;
+}
+
+int initialize_ooo_model(OooModel *model, const OooConfig *config) {
+    memset(model, 0, sizeof(*model));
+    model->config = *config;
+
+    size_t predictor_entries = (size_t)1 << config->predictor_bits;
+    model->counters = malloc(predictor_entries);
+    model->targets = calloc(predictor_entries, sizeof(uint32_t));
+    model->rob_retire = calloc(config->rob_size, sizeof(uint64_t));
+    model->lsq_retire = calloc(config->lsq_size, sizeof(uint64_t));
+    model->iq_issue = calloc(config->iq_size, sizeof(uint64_t));
+    model->issue_slots = calloc(OOO_CALENDAR_SIZE, sizeof(CalendarSlot));
+    model->divider_busy = calloc(config->units[FU_DIV], sizeof(uint64_t));
+    int allocated = model->counters && model->targets && model->rob_retire && model->lsq_retire &&
+                    model->iq_issue && model->issue_slots && model->divider_busy;
+    for (int i = 0; i < NUM_FU_CLASSES; i++) {
+        model->unit_slots[i] = calloc(OOO_CALENDAR_SIZE, sizeof(CalendarSlot));
+        allocated = allocated && model->unit_slots[i];
+    }
+
+    if (!allocated) {
+        fprintf(stderr, "Failed to allocate out-of-order model\n");
+        free_ooo_model(model);
+        return -1;
+    }
+
+    // Weakly not taken
+    memset(model->counters, 1, predictor_entries);
+    model->fetch_reason = STALL_MISPREDICT;
+    return 0;
+}
+
+void free_ooo_model(OooModel *model) {
+    free(model->counters);
+    free(model->targets);
+    free(model->rob_retire);
+    free(model->lsq_retire);
+    free(model->iq_issue);
+    free(model->issue_slots);
+    free(model->divider_busy);
+    for (int i = 0; i < NUM_FU_CLASSES; i++) {
+        free(model->unit_slots[i]);
+        model->unit_slots[i] = NULL;
+    }
+    model->counters = NULL;
+    model->targets = NULL;
+    model->rob_retire = NULL;
+    model->lsq_retire = NULL;
+    model->iq_issue = NULL;
+    model->issue_slots = NULL;
+    model->divider_busy = NULL;
+}
+
+static FunctionalUnitClass unit_class(const InstructionInfo *info) {
+    if (info->memop == MEM_LOAD || info->memop == MEM_STORE) return FU_MEM;
+    if (info->format == FMT_VMEM || info->format == FMT_VMEM_STRIDED) return FU_MEM;
+
+    switch (info->aluop) {
+        case Mul: case MulH: case MulHSU: case MulHU:
+            return FU_MUL;
+        case Div: case DivU: case Rem: case RemU:
+            return FU_DIV;
+        default:
+            return FU_ALU;
+    }
+}
+
+// Delays dispatch until ready and charges the lost cycles to reason
+static void wait_for(OooModel *model, uint64_t *cycle, uint64_t ready, DispatchStall reason) {
+    if (ready > *cycle) {
+        model->dispatch_stalls[reason] += ready - *cycle;
+        *cycle = ready;
+    }
+}
+
+// Issue queue entries are freed out of order, so the queue is a min-heap of
+// the cycles at which its entries leave.
+static uint64_t iq_pop(OooModel *model) {
+    uint64_t *heap = model->iq_issue;
+    uint64_t top = heap[0];
+    uint64_t last = heap[--model->iq_count];
+    uint32_t i = 0;
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= model->iq_count) break;
+        if (child + 1 < model->iq_count && heap[child + 1] < heap[child]) child++;
+        if (last <= heap[child]) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (model->iq_count > 0) heap[i] = last;
+    return top;
+}
+
+static void iq_push(OooModel *model, uint64_t cycle) {
+    uint64_t *heap = model->iq_issue;
+    uint32_t i = model->iq_count++;
+
+    while (i > 0 && heap[(i - 1) / 2] > cycle) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = cycle;
+}
+
+static CalendarSlot *calendar_slot(CalendarSlot *calendar, uint64_t cycle) {
+    CalendarSlot *slot = &calendar[cycle & (OOO_CALENDAR_SIZE - 1)];
+    if (slot->cycle != cycle) {
+        slot->cycle = cycle;
+        slot->used = 0;
+    }
+    return slot;
+}
+
+// Finds the first cycle from ready with both an issue slot and a unit of the class free
+static uint64_t book_unit(OooModel *model, FunctionalUnitClass class, uint64_t ready) {
+    for (uint64_t cycle = ready;; cycle++) {
+        CalendarSlot *issue = calendar_slot(model->issue_slots, cycle);
+        CalendarSlot *unit = calendar_slot(model->unit_slots[class], cycle);
+        if (issue->used < model->config.width && unit->used < model->config.units[class]) {
+            issue->used++;
+            unit->used++;
+            return cycle;
+        }
+    }
+}
+
+// Returns whether the front end predicted the instruction's successor correctly
+static int predict_control(OooModel *model, const Instruction *inst, uint32_t pc, uint32_t next_pc) {
+    uint32_t index = (pc >> 2) & ((1u << model->config.predictor_bits) - 1);
+
+    if (instruction_table[inst->id].format == FMT_B) {
+        int taken = next_pc != pc + 4;
+        uint8_t *counter = &model->counters[index];
+        int predicted = *counter >= 2;
+        if (taken && *counter < 3) (*counter)++;
+        if (!taken && *counter > 0) (*counter)--;
+        model->branches++;
+        return predicted == taken;
+    }
+
+    if (inst->id == INST_JALR) {
+        int hit = model->targets[index] == next_pc;
+        model->targets[index] = next_pc;
+        model->branches++;
+        return hit;
+    }
+
+    return 1;
+}
+
+// Places one retired instruction on the timeline. pc is its address, next_pc
+// the address that followed it and address the effective address of a load
+// or store. Fusion must be off so every instruction arrives on its own.
+void ooo_model_retire(OooModel *model, const Instruction *inst, uint32_t pc, uint32_t next_pc, uint32_t address) {
+    const OooConfig *config = &model->config;
+    const InstructionInfo *info = &instruction_table[inst->id];
+    FunctionalUnitClass class = unit_class(info);
+    int is_memory = class == FU_MEM;
+    int serializing = info->memop == MEM_ECALL || info->memop == MEM_EBREAK || info->memop == MEM_MRET ||
+                      info->memop == MEM_CSR;
+
+    model->instructions++;
+    model->class_count[class]++;
+
+    // Dispatch: in order, width per cycle, into free ROB, LSQ and IQ entries
+    uint64_t dispatch = model->dispatch_cycle;
+    if (model->dispatched_in_cycle >= config->width) dispatch++;
+    wait_for(model, &dispatch, model->fetch_cycle, model->fetch_reason);
+    if (serializing) wait_for(model, &dispatch, model->retire_cycle + 1, STALL_SERIALIZE);
+
+    uint64_t *rob_slot = &model->rob_retire[model->rob_index++ % config->rob_size];
+    wait_for(model, &dispatch, *rob_slot, STALL_ROB);
+
+    uint64_t *lsq_slot = NULL;
+    if (is_memory) {
+        lsq_slot = &model->lsq_retire[model->lsq_index++ % config->lsq_size];
+        wait_for(model, &dispatch, *lsq_slot, STALL_LSQ);
+    }
+
+    while (model->iq_count > 0 && model->iq_issue[0] <= dispatch) iq_pop(model);
+    if (model->iq_count == config->iq_size) wait_for(model, &dispatch, iq_pop(model), STALL_IQ);
+
+    if (dispatch != model->dispatch_cycle) {
+        model->dispatch_cycle = dispatch;
+        model->dispatched_in_cycle = 0;
+    }
+    model->dispatched_in_cycle++;
+
+    // Operands: renamed scalar and vector registers plus, for loads, data forwarded
+    // from an older store. A scalar source that is not read is taken as x0, which
+    // is always ready; vector sources cover whole register groups.
+    uint8_t rs1 = (inst->reads & READS_RS1) ? inst->rs1 : 0;
+    uint8_t rs2 = (inst->reads & READS_RS2) ? inst->rs2 : 0;
+    uint64_t operands = model->register_ready[rs1];
+    if (model->register_ready[rs2] > operands) operands = model->register_ready[rs2];
+    uint64_t depth = model->register_depth[rs1];
+    uint64_t chain = model->register_chain[rs1];
+    if (model->register_depth[rs2] > depth) {
+        depth = model->register_depth[rs2];
+        chain = model->register_chain[rs2];
+    }
+    for (uint32_t vregs = inst->vreads; vregs; vregs &= vregs - 1) {
+        int v = __builtin_ctz(vregs);
+        if (model->vector_ready[v] > operands) operands = model->vector_ready[v];
+        if (model->vector_depth[v] > depth) {
+            depth = model->vector_depth[v];
+            chain = model->vector_chain[v];
+        }
+    }
+
+    StoreEntry *store = &model->stores[(address >> 2) & (OOO_STORE_BUFFER_SIZE - 1)];
+    if (info->memop == MEM_LOAD && store->ready != 0 && store->address == (address & ~3u)) {
+        if (store->ready > dispatch) model->loads_forwarded++;
+        if (store->ready > operands) operands = store->ready;
+        if (store->depth > depth) depth = store->depth;
+    }
+
+    // Issue: operands ready, then a free issue slot and functional unit
+    uint64_t ready = dispatch + 1;
+    if (operands > ready) {
+        model->operand_wait += operands - ready;
+        ready = operands;
+    }
+
+    uint64_t *divider = NULL;
+    uint64_t unit_ready = ready;
+    if (class == FU_DIV) {
+        divider = &model->divider_busy[0];
+        for (uint32_t i = 1; i < config->units[FU_DIV]; i++) {
+            if (model->divider_busy[i] < *divider) divider = &model->divider_busy[i];
+        }
+        if (*divider > unit_ready) unit_ready = *divider;
+    }
+
+    uint64_t issue = book_unit(model, class, unit_ready);
+    model->unit_wait += issue - ready;
+    if (divider) *divider = issue + info->latency;
+    iq_push(model, issue + 1);
+
+    uint64_t complete = issue + info->latency;
+    depth += info->latency;
+    chain++;
+
+    if (inst->rd != 0) {
+        model->register_ready[inst->rd] = complete;
+        model->register_depth[inst->rd] = depth;
+        model->register_chain[inst->rd] = chain;
+    }
+    for (uint32_t vregs = inst->vwrites; vregs; vregs &= vregs - 1) {
+        int v = __builtin_ctz(vregs);
+        model->vector_ready[v] = complete;
+        model->vector_depth[v] = depth;
+        model->vector_chain[v] = chain;
+    }
+    if (info->memop == MEM_STORE) {
+        store->address = address & ~3u;
+        store->ready = complete;
+        store->depth = depth;
+    }
+    if (depth > model->critical_path) {
+        model->critical_path = depth;
+        model->critical_chain = chain;
+    }
+
+    // Retire: in order, width per cycle
+    uint64_t retire = complete > model->retire_cycle ? complete : model->retire_cycle;
+    if (retire == model->retire_cycle && model->retired_in_cycle >= config->width) retire++;
+    if (retire != model->retire_cycle) {
+        model->retire_cycle = retire;
+        model->retired_in_cycle = 0;
+    }
+    model->retired_in_cycle++;
+    *rob_slot = retire + 1;
+    if (lsq_slot) *lsq_slot = retire + 1;
+
+    // Front end for the next instruction
+    if (!predict_control(model, inst, pc, next_pc)) {
+        model->mispredicts++;
+        model->fetch_cycle = complete + config->mispredict_penalty;
+        model->fetch_reason = STALL_MISPREDICT;
+    } else if (serializing) {
+        model->fetch_cycle = retire + 1;
+        model->fetch_reason = STALL_SERIALIZE;
+    } else if (next_pc != pc + 4) {
+        // A taken branch or jump ends the fetch group
+        model->dispatched_in_cycle = config->width;
+    }
+}
+
+uint64_t ooo_model_cycles(const OooModel *model) {
+    return model->instructions ? model->retire_cycle + 1 : 0;
+}
+
+void print_ooo_report(const OooModel *model) {
+    const OooConfig *config = &model->config;
+    uint64_t cycles = ooo_model_cycles(model);
+    double instructions = model->instructions ? (double)model->instructions : 1.0;
+
+    printf("Out-of-order core timing\n");
+    printf("  Configuration:     width %u, ROB %u, IQ %u, LSQ %u, units alu %u mul %u div %u mem %u, penalty %u\n",
+           config->width, config->rob_size, config->iq_size, config->lsq_size,
+           config->units[FU_ALU], config->units[FU_MUL], config->units[FU_DIV], config->units[FU_MEM],
+           config->mispredict_penalty);
+    printf("  Instructions:      %llu\n", (unsigned long long)model->instructions);
+    printf("  Cycles:            %llu\n", (unsigned long long)cycles);
+    printf("  IPC:               %.3f\n", cycles ? model->instructions / (double)cycles : 0.0);
+    printf("  Mix:               alu %llu, mul %llu, div %llu, mem %llu\n",
+           (unsigned long long)model->class_count[FU_ALU], (unsigned long long)model->class_count[FU_MUL],
+           (unsigned long long)model->class_count[FU_DIV], (unsigned long long)model->class_count[FU_MEM]);
+    printf("  Branches:          %llu, %llu mispredicted (%.2f%%)\n",
+           (unsigned long long)model->branches, (unsigned long long)model->mispredicts,
+           model->branches ? 100.0 * model->mispredicts / model->branches : 0.0);
+    printf("  Store forwarding:  %llu loads\n", (unsigned long long)model->loads_forwarded);
+    printf("  Dispatch stalls (cycles):\n");
+    for (int i = 0; i < NUM_STALL_REASONS; i++) {
+        printf("    %-18s%llu\n", stall_names[i], (unsigned long long)model->dispatch_stalls[i]);
+    }
+    printf("  Operand wait:      %.3f cycles/instruction\n", model->operand_wait / instructions);
+    printf("  Unit wait:         %.3f cycles/instruction\n", model->unit_wait / instructions);
+    printf("  Critical path:     %llu cycles through %llu dependent instructions\n",
+           (unsigned long long)model->critical_path, (unsigned long long)model->critical_chain);
+    printf("  Dataflow IPC limit: %.3f\n",
+           model->critical_path ? model->instructions / (double)model->critical_path : 0.0);
+}
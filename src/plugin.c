@@ -0,0 +1,200 @@
+#include "plugin.h"
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    Plugin plugin;
+    void *handle;
+} LoadedPlugin;
+
+// Per-block instrumentation decisions, keyed by block start address. Each
+// mask has one bit per plugin index.
+typedef struct {
+    uint32_t pc;
+    uint32_t instruction_plugins;
+    uint32_t memory_plugins;
+    uint8_t used;                   // Set last, with release ordering
+} BlockEntry;
+
+// Open-addressing table read without a lock. Entries are only ever added:
+// an inserter fills in an entry before publishing its used flag, and
+// growing builds a complete new table before publishing the pointer. The
+// replaced tables stay allocated until unload_plugins, since a reader may
+// still be probing one; together they are smaller than the live table.
+typedef struct BlockTable {
+    uint32_t capacity;
+    struct BlockTable *previous;    // Replaced table, freed at unload
+    BlockEntry entries[];
+} BlockTable;
+
+static LoadedPlugin plugins[MAX_PLUGINS];
+static int num_plugins = 0;
+uint32_t plugin_events = 0;
+
+static BlockTable *blocks = NULL;
+static uint32_t num_blocks = 0;
+static pthread_mutex_t block_lock = PTHREAD_MUTEX_INITIALIZER;     // Serializes inserts
+
+int load_plugin(const char *path, const char *args) {
+    if (num_plugins == MAX_PLUGINS) {
+        fprintf(stderr, "Too many plugins\n");
+        return -1;
+    }
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "Could not load plugin %s: %s\n", path, dlerror());
+        return -1;
+    }
+
+    PluginInstallFunction install = (PluginInstallFunction)dlsym(handle, PLUGIN_INSTALL_SYMBOL);
+    if (!install) {
+        fprintf(stderr, "Plugin %s does not export %s\n", path, PLUGIN_INSTALL_SYMBOL);
+        dlclose(handle);
+        return -1;
+    }
+
+    LoadedPlugin *loaded = &plugins[num_plugins];
+    memset(loaded, 0, sizeof(*loaded));
+    loaded->handle = handle;
+    if (install(&loaded->plugin, PLUGIN_API_VERSION, args) != 0) {
+        fprintf(stderr, "Plugin %s failed to install\n", path);
+        dlclose(handle);
+        return -1;
+    }
+    num_plugins++;
+
+    const Plugin *plugin = &loaded->plugin;
+    if (plugin->block_translate || plugin->block_execute ||
+        plugin->instruction_retire || plugin->memory_access) {
+        plugin_events |= PLUGIN_EVENT_BLOCKS;
+    }
+    if (plugin->instruction_retire) plugin_events |= PLUGIN_EVENT_INSTRUCTIONS;
+    if (plugin->syscall) plugin_events |= PLUGIN_EVENT_SYSCALL;
+    return 0;
+}
+
+void unload_plugins(void) {
+    for (int i = 0; i < num_plugins; i++) {
+        if (plugins[i].plugin.finish) plugins[i].plugin.finish(plugins[i].plugin.data);
+        dlclose(plugins[i].handle);
+    }
+    num_plugins = 0;
+    plugin_events = 0;
+
+    while (blocks) {
+        BlockTable *previous = blocks->previous;
+        free(blocks);
+        blocks = previous;
+    }
+    num_blocks = 0;
+}
+
+static uint32_t hash_pc(uint32_t pc) {
+    return (pc >> 2) * 0x9E3779B1u;
+}
+
+static BlockEntry *find_block_slot(BlockTable *table, uint32_t pc) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t index = hash_pc(pc) & mask;
+    while (__atomic_load_n(&table->entries[index].used, __ATOMIC_ACQUIRE) && table->entries[index].pc != pc) {
+        index = (index + 1) & mask;
+    }
+    return &table->entries[index];
+}
+
+static BlockTable *allocate_block_table(uint32_t capacity) {
+    BlockTable *table = calloc(1, sizeof(BlockTable) + capacity * sizeof(BlockEntry));
+    table->capacity = capacity;
+    return table;
+}
+
+// Called with block_lock held
+static void grow_block_table(void) {
+    BlockTable *old = blocks;
+    BlockTable *table = allocate_block_table(old ? old->capacity * 2 : 1024);
+
+    if (old) {
+        for (uint32_t i = 0; i < old->capacity; i++) {
+            if (old->entries[i].used) *find_block_slot(table, old->entries[i].pc) = old->entries[i];
+        }
+    }
+    table->previous = old;
+    __atomic_store_n(&blocks, table, __ATOMIC_RELEASE);
+}
+
+// Asks every plugin how it wants to instrument a newly seen block
+static BlockEntry translate_block(VirtualMachine *vm, uint32_t pc) {
+    BlockEntry entry = { pc, 0, 0, 1 };
+
+    for (int i = 0; i < num_plugins; i++) {
+        Plugin *plugin = &plugins[i].plugin;
+        uint32_t wanted = PLUGIN_WANT_INSTRUCTIONS | PLUGIN_WANT_MEMORY;
+        if (plugin->block_translate) wanted = plugin->block_translate(plugin->data, vm, pc);
+
+        if ((wanted & PLUGIN_WANT_INSTRUCTIONS) && plugin->instruction_retire) {
+            entry.instruction_plugins |= 1u << i;
+        }
+        if ((wanted & PLUGIN_WANT_MEMORY) && plugin->memory_access) {
+            entry.memory_plugins |= 1u << i;
+        }
+    }
+    return entry;
+}
+
+// Called by the instruction loop at the first instruction of every block.
+// Blocks seen before are found without taking the lock.
+void plugin_enter_block(VirtualMachine *vm) {
+    uint32_t pc = vm->program_counter;
+
+    BlockTable *table = __atomic_load_n(&blocks, __ATOMIC_ACQUIRE);
+    BlockEntry *slot = table ? find_block_slot(table, pc) : NULL;
+
+    if (!slot || !slot->used) {
+        pthread_mutex_lock(&block_lock);
+        if ((num_blocks + 1) * 2 > (blocks ? blocks->capacity : 0)) grow_block_table();
+        // Another thread may have added the block while we waited
+        slot = find_block_slot(blocks, pc);
+        if (!slot->used) {
+            BlockEntry entry = translate_block(vm, pc);
+            slot->pc = entry.pc;
+            slot->instruction_plugins = entry.instruction_plugins;
+            slot->memory_plugins = entry.memory_plugins;
+            __atomic_store_n(&slot->used, 1, __ATOMIC_RELEASE);
+            num_blocks++;
+        }
+        pthread_mutex_unlock(&block_lock);
+    }
+
+    vm->instruction_plugins = slot->instruction_plugins;
+    vm->memory_plugins = slot->memory_plugins;
+
+    for (int i = 0; i < num_plugins; i++) {
+        Plugin *plugin = &plugins[i].plugin;
+        if (plugin->block_execute) plugin->block_execute(plugin->data, vm, pc);
+    }
+}
+
+void plugin_instruction_retired(VirtualMachine *vm, const Instruction *inst, uint32_t pc) {
+    for (uint32_t mask = vm->instruction_plugins; mask; mask &= mask - 1) {
+        Plugin *plugin = &plugins[__builtin_ctz(mask)].plugin;
+        plugin->instruction_retire(plugin->data, vm, inst, pc);
+    }
+}
+
+void plugin_memory_access(VirtualMachine *vm, uint32_t address, uint8_t width, int is_store, uint32_t value) {
+    for (uint32_t mask = vm->memory_plugins; mask; mask &= mask - 1) {
+        Plugin *plugin = &plugins[__builtin_ctz(mask)].plugin;
+        plugin->memory_access(plugin->data, vm, address, width, is_store, value);
+    }
+}
+
+void plugin_syscall(VirtualMachine *vm, uint32_t number) {
+    for (int i = 0; i < num_plugins; i++) {
+        Plugin *plugin = &plugins[i].plugin;
+        if (plugin->syscall) plugin->syscall(plugin->data, vm, number);
+    }
+}
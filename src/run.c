@@ -0,0 +1,125 @@
+#include "run.h"
+#include "fetch.h"
+#include "decode.h"
+#include "execute.h"
+#include "memory.h"
+#include "writeback.h"
+#include "timing.h"
+#include "ooo.h"
+#include "trap.h"
+#include "plugin.h"
+#include "fusion.h"
+#include <stdio.h>
+
+// Runs one instruction (or one fused pair) through every stage. Returns the
+// number of instructions retired, or 0 once the machine has left VM_RUNNING.
+int step_instruction(VirtualMachine *vm) {
+    Instruction inst;
+    uint32_t pc = vm->program_counter;
+
+    if (vm->block_start) {
+        vm->block_start = 0;
+        if (plugin_events && !vm->replay) plugin_enter_block(vm);
+    }
+
+    // Fetch instruction
+    if (fetch(vm, &inst) != 0) {
+        if (vm->trace) {
+            fprintf(stderr, "Error fetching instruction or end of program reached\n");
+        }
+        vm->state = VM_STOPPED;
+        return 0;
+    }
+
+    if (vm->trace) {
+        printf("Instruction #%llu: PC=0x%08X, Inst=0x%08X\n",
+               (unsigned long long)vm->retired_instructions + 1, vm->program_counter - 4, inst.inst);
+    }
+
+    // Decode the fetched instruction
+    decode_instruction(vm, &inst);
+    uint32_t next_pc = vm->program_counter;
+
+    // Check for unsupported instruction
+    if (inst.type == UNSUPPORTED_TYPE) {
+        fprintf(stderr, "Unsupported instruction: 0x%08X at PC=0x%08X\n",
+                inst.inst, vm->program_counter - 4);
+        vm->state = VM_FAULT;
+        vm->exit_code = 1;
+        return 0;
+    }
+
+    // Print decoded instruction for debugging
+    if (vm->trace) print_decoded_instruction(&inst);
+
+    // Execute the instruction (includes PC updates for branches/jumps)
+    int32_t result;
+    execute_stage(vm, &inst, &result);
+
+    // Perform memory operations (this may stop or park the machine via ECALL)
+    uint32_t address = (uint32_t)result;
+    memory_stage(vm, &inst, &result);
+    if (vm->state == VM_FAULT && inst.fusion == FUSION_AUIPC_LOAD) {
+        // The AUIPC half retires before its load faults, leaving rd and the
+        // count as the unfused pair would (left holds PC + hi)
+        writeback_stage(vm, &inst, inst.left);
+        vm->retired_instructions++;
+    }
+    if (vm->state == VM_FAULT || vm->state == VM_BLOCKED) return 0;
+
+    if (vm->memory_plugins && (inst.memop == MEM_LOAD || inst.memop == MEM_STORE)) {
+        int is_store = inst.memop == MEM_STORE;
+        plugin_memory_access(vm, address, 1 << (inst.funct3 & 0x3), is_store,
+                             is_store ? inst.disp_strval : (uint32_t)result);
+    }
+
+    // Perform writeback stage
+    writeback_stage(vm, &inst, result);
+
+    if (vm->trace) {
+        printf("Result after writeback: 0x%08X\n", result);
+        printf("------------------------\n");
+    }
+
+    int redirected = vm->program_counter != next_pc;
+    if (vm->timing) {
+        timing_model_retire(vm->timing, &inst, redirected);
+    }
+    if (vm->ooo) {
+        ooo_model_retire(vm->ooo, &inst, pc, vm->program_counter, address);
+    }
+
+    if (vm->instruction_plugins) {
+        plugin_instruction_retired(vm, &inst, pc);
+    }
+
+    // Interrupts are only taken at block boundaries
+    if (redirected) {
+        check_interrupts(vm);
+        vm->block_start = 1;
+    }
+
+    // A fused pair retires two instructions
+    int retired = (inst.fusion != 0) ? 2 : 1;
+    vm->retired_instructions += retired;
+    return retired;
+}
+
+// Runs until the machine stops or max_instructions have retired, leaving
+// the machine in VM_RUNNING in the latter case so it can be resumed.
+// Returns the number of instructions retired by this call.
+uint64_t run_machine(VirtualMachine *vm, uint64_t max_instructions) {
+    uint64_t start = vm->retired_instructions;
+
+    uint8_t fuse_instructions = vm->fuse_instructions;
+
+    while (vm->state == VM_RUNNING && vm->retired_instructions - start < max_instructions) {
+        // A fused pair retires two, so the last instruction of the budget runs alone
+        if (vm->retired_instructions - start + 1 == max_instructions) vm->fuse_instructions = 0;
+        step_instruction(vm);
+    }
+
+    vm->fuse_instructions = fuse_instructions;
+
+    return vm->retired_instructions - start;
+}
@@ -0,0 +1,313 @@
+#define _GNU_SOURCE
+#include "scheduler.h"
+#include "run.h"
+#include "host_io.h"
+#include "plugin.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// A guest is owned by exactly one of: the run queue, a worker running it,
+// or the epoll set (parked with a one-shot registration). Whoever takes it
+// off one of them is the only thread touching it until it hands it on.
+
+typedef struct Guest {
+    VirtualMachine vm;
+    int files[NUM_GUEST_FILES];
+    uint64_t id;
+    uint64_t parks;                 // Times parked on a blocking syscall
+    struct Guest *next;             // Run queue link
+} Guest;
+
+typedef struct {
+    const GuestImage *image;
+    const SchedulerOptions *options;
+    int epoll_fd;
+    int listen_fd;
+    int finished_fd;                // eventfd raised when the last guest finishes
+
+    pthread_mutex_t lock;
+    pthread_cond_t runnable;
+    Guest *head;                    // Run queue, FIFO
+    Guest *tail;
+    int shutdown;
+    int accepting;
+    uint64_t accepted;
+    uint64_t resident;
+    uint64_t peak_resident;
+
+    // Totals over finished guests
+    uint64_t instructions;
+    uint64_t parks;
+    uint64_t failed;                // Guests that faulted, hit the limit or exited non-zero
+} Scheduler;
+
+static void enqueue_guest(Scheduler *scheduler, Guest *guest) {
+    pthread_mutex_lock(&scheduler->lock);
+    guest->next = NULL;
+    if (scheduler->tail) {
+        scheduler->tail->next = guest;
+    } else {
+        scheduler->head = guest;
+    }
+    scheduler->tail = guest;
+    pthread_cond_signal(&scheduler->runnable);
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+// Blocks until a guest is runnable; returns NULL at shutdown
+static Guest *dequeue_guest(Scheduler *scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+    while (!scheduler->head && !scheduler->shutdown) {
+        pthread_cond_wait(&scheduler->runnable, &scheduler->lock);
+    }
+    Guest *guest = scheduler->head;
+    if (guest) {
+        scheduler->head = guest->next;
+        if (!scheduler->head) scheduler->tail = NULL;
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+    return guest;
+}
+
+static void finish_guest(Scheduler *scheduler, Guest *guest) {
+    VirtualMachine *vm = &guest->vm;
+    int failed = vm->state != VM_EXITED || vm->exit_code != 0;
+
+    if (vm->state == VM_RUNNING) {
+        fprintf(stderr, "Guest %llu: maximum instruction limit reached\n", (unsigned long long)guest->id);
+    }
+
+    // Closing the connection also removes it from the epoll set
+    close(guest->files[0]);
+    free_machine(vm);
+
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->instructions += vm->retired_instructions;
+    scheduler->parks += guest->parks;
+    scheduler->failed += failed;
+    scheduler->resident--;
+    if (scheduler->resident == 0 && !scheduler->accepting) {
+        uint64_t one = 1;
+        if (write(scheduler->finished_fd, &one, sizeof(one)) < 0) perror("write");
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+    free(guest);
+}
+
+// Hands the guest to epoll. After epoll_ctl the poller may resume it at any
+// moment, so the guest must not be touched here afterwards.
+static void park_guest(Scheduler *scheduler, Guest *guest) {
+    struct epoll_event event;
+    event.events = guest->vm.wait_events | EPOLLONESHOT;
+    event.data.ptr = guest;
+    guest->parks++;
+
+    int fd = guest->vm.wait_fd;
+    if (epoll_ctl(scheduler->epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0) return;
+    if (errno == ENOENT && epoll_ctl(scheduler->epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) return;
+
+    perror("epoll_ctl");
+    guest->vm.state = VM_FAULT;
+    finish_guest(scheduler, guest);
+}
+
+static void *scheduler_worker(void *argument) {
+    Scheduler *scheduler = argument;
+    uint64_t max_instructions = scheduler->options->max_instructions;
+
+    Guest *guest;
+    while ((guest = dequeue_guest(scheduler)) != NULL) {
+        VirtualMachine *vm = &guest->vm;
+        uint64_t slice = SCHEDULER_TIME_SLICE;
+        if (max_instructions && max_instructions - vm->retired_instructions < slice) {
+            slice = max_instructions - vm->retired_instructions;
+        }
+        run_machine(vm, slice);
+
+        if (vm->state == VM_BLOCKED) {
+            park_guest(scheduler, guest);
+        } else if (vm->state == VM_RUNNING && (!max_instructions || vm->retired_instructions < max_instructions)) {
+            enqueue_guest(scheduler, guest);
+        } else {
+            finish_guest(scheduler, guest);
+        }
+    }
+    return NULL;
+}
+
+static void stop_accepting(Scheduler *scheduler) {
+    epoll_ctl(scheduler->epoll_fd, EPOLL_CTL_DEL, scheduler->listen_fd, NULL);
+    close(scheduler->listen_fd);
+    unlink(scheduler->options->socket_path);
+    scheduler->listen_fd = -1;
+}
+
+// Turns every pending connection into a runnable guest
+static void accept_guests(Scheduler *scheduler) {
+    for (;;) {
+        int connection = accept4(scheduler->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (connection < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+            return;
+        }
+
+        Guest *guest = malloc(sizeof(Guest));
+        if (!guest || initialize_machine_from_image(&guest->vm, scheduler->image) != 0) {
+            free(guest);
+            close(connection);
+            continue;
+        }
+        for (int fd = 0; fd < NUM_GUEST_FILES; fd++) guest->files[fd] = connection;
+        guest->vm.host_files = guest->files;
+        guest->vm.trace = 0;
+        if (plugin_events & PLUGIN_EVENT_INSTRUCTIONS) guest->vm.fuse_instructions = 0;
+        guest->parks = 0;
+
+        pthread_mutex_lock(&scheduler->lock);
+        guest->id = ++scheduler->accepted;
+        scheduler->resident++;
+        if (scheduler->resident > scheduler->peak_resident) scheduler->peak_resident = scheduler->resident;
+        uint64_t max_guests = scheduler->options->max_guests;
+        if (max_guests && scheduler->accepted == max_guests) scheduler->accepting = 0;
+        int accepting = scheduler->accepting;
+        pthread_mutex_unlock(&scheduler->lock);
+
+        enqueue_guest(scheduler, guest);
+        if (!accepting) {
+            stop_accepting(scheduler);
+            return;
+        }
+    }
+}
+
+static int open_listen_socket(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// The calling thread becomes the poller: it accepts connections and moves
+// guests whose connection became ready back to the run queue.
+int run_scheduler(const GuestImage *image, const SchedulerOptions *options) {
+    Scheduler scheduler;
+    memset(&scheduler, 0, sizeof(scheduler));
+    scheduler.image = image;
+    scheduler.options = options;
+    scheduler.accepting = 1;
+    pthread_mutex_init(&scheduler.lock, NULL);
+    pthread_cond_init(&scheduler.runnable, NULL);
+
+    scheduler.listen_fd = open_listen_socket(options->socket_path);
+    if (scheduler.listen_fd < 0) return -1;
+    scheduler.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    scheduler.finished_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (scheduler.epoll_fd < 0 || scheduler.finished_fd < 0) {
+        perror("epoll");
+        return -1;
+    }
+
+    // The listening socket and the eventfd are told apart from guests by data.ptr
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &scheduler.listen_fd;
+    epoll_ctl(scheduler.epoll_fd, EPOLL_CTL_ADD, scheduler.listen_fd, &event);
+    event.data.ptr = &scheduler.finished_fd;
+    epoll_ctl(scheduler.epoll_fd, EPOLL_CTL_ADD, scheduler.finished_fd, &event);
+
+    // A guest writing to a closed connection gets -EPIPE instead of killing us
+    signal(SIGPIPE, SIG_IGN);
+
+    int num_workers = options->num_workers > 0 ? options->num_workers : 1;
+    pthread_t *threads = malloc(num_workers * sizeof(pthread_t));
+    for (int i = 0; i < num_workers; i++) {
+        pthread_create(&threads[i], NULL, scheduler_worker, &scheduler);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct epoll_event events[SCHEDULER_EVENTS];
+    for (;;) {
+        pthread_mutex_lock(&scheduler.lock);
+        int finished = !scheduler.accepting && scheduler.resident == 0;
+        pthread_mutex_unlock(&scheduler.lock);
+        if (finished) break;
+
+        int count = epoll_wait(scheduler.epoll_fd, events, SCHEDULER_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            void *source = events[i].data.ptr;
+            if (source == &scheduler.listen_fd) {
+                if (scheduler.listen_fd >= 0) accept_guests(&scheduler);
+            } else if (source != &scheduler.finished_fd) {
+                Guest *guest = source;
+                guest->vm.state = VM_RUNNING;
+                enqueue_guest(&scheduler, guest);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&scheduler.lock);
+    scheduler.shutdown = 1;
+    pthread_cond_broadcast(&scheduler.runnable);
+    pthread_mutex_unlock(&scheduler.lock);
+    for (int i = 0; i < num_workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    double seconds = elapsed_seconds(&start);
+    printf("Scheduler: %llu guests on %d workers\n", (unsigned long long)scheduler.accepted, num_workers);
+    printf("  Peak resident:     %llu\n", (unsigned long long)scheduler.peak_resident);
+    printf("  Failed:            %llu\n", (unsigned long long)scheduler.failed);
+    printf("  Instructions:      %llu\n", (unsigned long long)scheduler.instructions);
+    printf("  Parked syscalls:   %llu\n", (unsigned long long)scheduler.parks);
+    printf("  Elapsed:           %.3f s (%.1f MIPS)\n", seconds,
+           seconds > 0 ? scheduler.instructions / seconds / 1e6 : 0.0);
+
+    if (scheduler.listen_fd >= 0) stop_accepting(&scheduler);
+    close(scheduler.finished_fd);
+    close(scheduler.epoll_fd);
+    pthread_cond_destroy(&scheduler.runnable);
+    pthread_mutex_destroy(&scheduler.lock);
+    return scheduler.failed ? 1 : 0;
+}
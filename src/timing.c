@@ -0,0 +1,61 @@
+#include "timing.h"
+#include "isa.h"
+#include <stdio.h>
+#include <string.h>
+
+void initialize_timing_model(TimingModel *model) {
+    memset(model, 0, sizeof(*model));
+}
+
+// Accounts for one retired instruction. redirected is set when the
+// instruction changed the program counter (taken branch or jump).
+void timing_model_retire(TimingModel *model, const Instruction *inst, int redirected) {
+    const InstructionInfo *info = &instruction_table[inst->id];
+
+    model->instructions++;
+
+    if (model->pending_load_rd != 0 &&
+        (((inst->reads & READS_RS1) && inst->rs1 == model->pending_load_rd) ||
+         ((inst->reads & READS_RS2) && inst->rs2 == model->pending_load_rd))) {
+        model->load_use_stalls += LOAD_USE_PENALTY;
+    } else if (inst->vreads & model->pending_load_vregs) {
+        model->load_use_stalls += LOAD_USE_PENALTY;
+    }
+
+    if (info->memop != MEM_LOAD && info->latency > 1) {
+        model->execute_stalls += info->latency - 1;
+    }
+
+    if (redirected) {
+        model->control_stalls += BRANCH_PENALTY;
+    }
+
+    model->pending_load_rd = (info->memop == MEM_LOAD) ? inst->rd : 0;
+    model->pending_load_vregs = (info->memop == MEM_VECTOR && inst->opcode == 0x07) ? inst->vwrites : 0;
+}
+
+void merge_timing_model(TimingModel *total, const TimingModel *part) {
+    total->instructions += part->instructions;
+    total->load_use_stalls += part->load_use_stalls;
+    total->execute_stalls += part->execute_stalls;
+    total->control_stalls += part->control_stalls;
+}
+
+uint64_t timing_model_cycles(const TimingModel *model) {
+    if (model->instructions == 0) return 0;
+    // One cycle per instruction once the pipeline has filled
+    return (PIPELINE_DEPTH - 1) + model->instructions +
+           model->load_use_stalls + model->execute_stalls + model->control_stalls;
+}
+
+void print_timing_report(const TimingModel *model) {
+    uint64_t cycles = timing_model_cycles(model);
+
+    printf("In-order pipeline timing\n");
+    printf("  Instructions:      %llu\n", (unsigned long long)model->instructions);
+    printf("  Cycles:            %llu\n", (unsigned long long)cycles);
+    printf("  CPI:               %.3f\n", model->instructions ? (double)cycles / model->instructions : 0.0);
+    printf("  Load-use stalls:   %llu\n", (unsigned long long)model->load_use_stalls);
+    printf("  Execute stalls:    %llu\n", (unsigned long long)model->execute_stalls);
+    printf("  Control stalls:    %llu\n", (unsigned long long)model->control_stalls);
+}
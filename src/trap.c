@@ -0,0 +1,46 @@
+#include "trap.h"
+#include "clint.h"
+#include <stdio.h>
+
+// Refreshes the device-driven bits of mip
+void update_pending_interrupts(VirtualMachine *vm) {
+    if (vm->clint) {
+        vm->mip = (vm->mip & ~(MIP_MSIP | MIP_MTIP)) | clint_pending_interrupts(vm->clint);
+    }
+}
+
+// Called at block boundaries (after an instruction that redirected the
+// program counter) rather than after every instruction. Takes the highest
+// priority enabled interrupt, if any.
+void check_interrupts(VirtualMachine *vm) {
+    if (!(vm->mstatus & MSTATUS_MIE) || vm->mie == 0) return;
+
+    update_pending_interrupts(vm);
+    uint32_t pending = vm->mip & vm->mie;
+    if (pending == 0) return;
+
+    uint32_t cause;
+    if (pending & MIP_MEIP) cause = CAUSE_MACHINE_EXTERNAL;
+    else if (pending & MIP_MSIP) cause = CAUSE_MACHINE_SOFTWARE;
+    else cause = CAUSE_MACHINE_TIMER;
+
+    // Resume at the instruction that would have run next
+    vm->mepc = vm->program_counter;
+    vm->mcause = CAUSE_INTERRUPT | cause;
+    vm->mstatus = (vm->mstatus & ~MSTATUS_MPIE) | ((vm->mstatus & MSTATUS_MIE) ? MSTATUS_MPIE : 0);
+    vm->mstatus = (vm->mstatus & ~MSTATUS_MIE) | MSTATUS_MPP;
+
+    // Vectored mode (mtvec[0] set) jumps to base + 4 * cause
+    uint32_t base = vm->mtvec & ~3u;
+    vm->program_counter = (vm->mtvec & 1) ? base + 4 * cause : base;
+
+    if (vm->trace) printf("Interrupt %u taken, jumping to PC: 0x%08X\n", cause, vm->program_counter);
+}
+
+// MRET
+void return_from_trap(VirtualMachine *vm) {
+    vm->program_counter = vm->mepc;
+    vm->mstatus = (vm->mstatus & ~MSTATUS_MIE) | ((vm->mstatus & MSTATUS_MPIE) ? MSTATUS_MIE : 0);
+    vm->mstatus |= MSTATUS_MPIE;
+    if (vm->trace) printf("MRET to PC: 0x%08X\n", vm->program_counter);
+}
@@ -0,0 +1,102 @@
+#include "uart.h"
+#include <poll.h>
+#include <unistd.h>
+
+// Register offsets
+#define UART_RBR 0      // Receive buffer (read), transmit holding (write), DLL when DLAB
+#define UART_IER 1      // Interrupt enable, DLM when DLAB
+#define UART_IIR 2      // Interrupt identification (read), FIFO control (write)
+#define UART_LCR 3
+#define UART_MCR 4
+#define UART_LSR 5
+#define UART_MSR 6
+#define UART_SCR 7
+
+#define LCR_DLAB 0x80
+#define LSR_DATA_READY 0x01
+#define LSR_THR_EMPTY 0x20
+#define LSR_TRANSMITTER_EMPTY 0x40
+
+void initialize_uart(Uart *uart, int input_fd, int output_fd) {
+    uart->input_fd = input_fd;
+    uart->output_fd = output_fd;
+    uart->ier = 0;
+    uart->lcr = 0x03; // 8N1
+    uart->mcr = 0;
+    uart->scr = 0;
+    uart->dll = 0;
+    uart->dlm = 0;
+}
+
+static int input_ready(Uart *uart) {
+    struct pollfd pfd = { uart->input_fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+static uint32_t uart_read(void *device, uint32_t offset, uint8_t width) {
+    Uart *uart = device;
+    int dlab = uart->lcr & LCR_DLAB;
+
+    switch (offset) {
+        case UART_RBR: {
+            if (dlab) return uart->dll;
+            uint8_t byte = 0;
+            if (input_ready(uart) && read(uart->input_fd, &byte, 1) != 1) byte = 0;
+            return byte;
+        }
+        case UART_IER:
+            return dlab ? uart->dlm : uart->ier;
+        case UART_IIR:
+            return 0x01; // No interrupt pending
+        case UART_LCR:
+            return uart->lcr;
+        case UART_MCR:
+            return uart->mcr;
+        case UART_LSR:
+            // Output is written straight to the host, so the transmitter is always empty
+            return LSR_THR_EMPTY | LSR_TRANSMITTER_EMPTY | (input_ready(uart) ? LSR_DATA_READY : 0);
+        case UART_MSR:
+            return 0;
+        case UART_SCR:
+            return uart->scr;
+        default:
+            return 0;
+    }
+}
+
+static void uart_write(void *device, uint32_t offset, uint32_t value, uint8_t width) {
+    Uart *uart = device;
+    int dlab = uart->lcr & LCR_DLAB;
+    uint8_t byte = (uint8_t)value;
+
+    switch (offset) {
+        case UART_RBR:
+            if (dlab) {
+                uart->dll = byte;
+            } else if (write(uart->output_fd, &byte, 1) != 1) {
+                // Nothing sensible to report to the guest; the byte is dropped
+            }
+            break;
+        case UART_IER:
+            if (dlab) uart->dlm = byte;
+            else uart->ier = byte & 0x0F;
+            break;
+        case UART_LCR:
+            uart->lcr = byte;
+            break;
+        case UART_MCR:
+            uart->mcr = byte & 0x1F;
+            break;
+        case UART_SCR:
+            uart->scr = byte;
+            break;
+        default:
+            // FCR and the read-only status registers ignore writes
+            break;
+    }
+}
+
+int attach_uart(DeviceBus *bus, Uart *uart, uint32_t base) {
+    BusRegion region = { "uart", base, UART_SIZE, uart, uart_read, uart_write };
+    return bus_register_region(bus, &region);
+}
@@ -0,0 +1,575 @@
+#include "vector.h"
+#include "isa.h"
+#include "bus.h"
+#include "plugin.h"
+#include <stdio.h>
+#include <string.h>
+
+// Every vector instruction runs as one kernel: a loop over its register
+// group VECTOR_CHUNK bytes at a time, written with GCC vector extensions so
+// the compiler emits SSE, AVX2 or NEON code depending on SIMD_FLAGS. Only
+// the last chunk and chunks of masked instructions pay for merging the
+// result into the old destination. Register groups are contiguous in
+// vm->vregs and followed by VECTOR_PADDING bytes, so a chunk may run past
+// the end of a group.
+
+typedef int8_t vi8 __attribute__((vector_size(VECTOR_CHUNK)));
+typedef uint8_t vu8 __attribute__((vector_size(VECTOR_CHUNK)));
+typedef int16_t vi16 __attribute__((vector_size(VECTOR_CHUNK)));
+typedef uint16_t vu16 __attribute__((vector_size(VECTOR_CHUNK)));
+typedef int32_t vi32 __attribute__((vector_size(VECTOR_CHUNK)));
+typedef uint32_t vu32 __attribute__((vector_size(VECTOR_CHUNK)));
+
+// Double-width lanes for the high half of products
+typedef int16_t wi8 __attribute__((vector_size(2 * VECTOR_CHUNK)));
+typedef uint16_t wu8 __attribute__((vector_size(2 * VECTOR_CHUNK)));
+typedef int32_t wi16 __attribute__((vector_size(2 * VECTOR_CHUNK)));
+typedef uint32_t wu16 __attribute__((vector_size(2 * VECTOR_CHUNK)));
+typedef int64_t wi32 __attribute__((vector_size(2 * VECTOR_CHUNK)));
+typedef uint64_t wu32 __attribute__((vector_size(2 * VECTOR_CHUNK)));
+
+#define SELECT(mask, x, y) (((x) & (mask)) | ((y) & ~(mask)))
+
+typedef struct {
+    void (*elementwise)(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1,
+                        int32_t scalar, uint32_t vl, const uint8_t *mask);
+    void (*compare)(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1,
+                    int32_t scalar, uint32_t vl, const uint8_t *mask);
+    void (*reduce)(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1,
+                   uint32_t vl, const uint8_t *mask);
+} VectorKernels;
+
+// count (8, 16 or 32) mask bits starting at bit first, a multiple of 8
+static inline uint32_t read_mask_bits(const uint8_t *mask, uint32_t first, uint32_t count) {
+    uint32_t bits = 0;
+    memcpy(&bits, mask + first / 8, count / 8);
+    return bits;
+}
+
+static inline void write_mask_bits(uint8_t *mask, uint32_t first, uint32_t count, uint32_t bits) {
+    memcpy(mask + first / 8, &bits, count / 8);
+}
+
+static inline uint32_t all_lanes(uint32_t lanes) {
+    return lanes == 32 ? ~0u : (1u << lanes) - 1;
+}
+
+// Lanes of the chunk starting at element first that lie below vl
+static inline uint32_t body_lanes(uint32_t first, uint32_t lanes, uint32_t vl) {
+    return vl - first >= lanes ? all_lanes(lanes) : (1u << (vl - first)) - 1;
+}
+
+// Kernels for one element width. S/U are the signed and unsigned chunk
+// types, W/WU the double-width ones and T the element type.
+#define DEFINE_VECTOR_KERNELS(BITS, S, U, W, WU, T, TMIN, TMAX)                                  \
+static inline S lane_mask_##BITS(uint32_t bits) {                                               \
+    S lanes;                                                                                     \
+    for (int i = 0; i < (int)(VECTOR_CHUNK / sizeof(T)); i++) lanes[i] = -(T)((bits >> i) & 1); \
+    return lanes;                                                                                \
+}                                                                                                \
+                                                                                                 \
+static inline S elementwise_op_##BITS(AluOp op, S d, S a, S b, S index) {                       \
+    S zero = b == 0;                                                                             \
+    S one = (S){0} + 1;                                                                          \
+    S ones = (S){0} - 1;                                                                         \
+    switch (op) {                                                                                \
+        case Add: return (S)((U)a + (U)b);                                                       \
+        case Sub: return (S)((U)a - (U)b);                                                       \
+        case RSub: return (S)((U)b - (U)a);                                                      \
+        case And: return a & b;                                                                  \
+        case Or: return a | b;                                                                   \
+        case Xor: return a ^ b;                                                                  \
+        case LeftShift: return (S)((U)a << ((U)b & (BITS - 1)));                                 \
+        case RightShiftL: return (S)((U)a >> ((U)b & (BITS - 1)));                               \
+        case RightShiftA: return a >> (b & (BITS - 1));                                          \
+        case Min: return SELECT(a < b, a, b);                                                    \
+        case MinU: return SELECT((U)a < (U)b, a, b);                                             \
+        case Max: return SELECT(a > b, a, b);                                                    \
+        case MaxU: return SELECT((U)a > (U)b, a, b);                                             \
+        case Mul: return (S)((U)a * (U)b);                                                       \
+        case MulH:                                                                               \
+            return __builtin_convertvector((__builtin_convertvector(a, W) *                     \
+                                            __builtin_convertvector(b, W)) >> BITS, S);          \
+        case MulHU:                                                                              \
+            return (S)__builtin_convertvector((__builtin_convertvector((U)a, WU) *              \
+                                               __builtin_convertvector((U)b, WU)) >> BITS, U);   \
+        case MulHSU:                                                                             \
+            return __builtin_convertvector((__builtin_convertvector(a, W) *                     \
+                                            (W)__builtin_convertvector((U)b, WU)) >> BITS, S);   \
+        case Div: {                                                                              \
+            /* x / 0 is all ones and MIN / -1 is MIN, neither may reach the host divider */     \
+            S overflow = (a == TMIN) & (b == -1);                                                \
+            return SELECT(zero, ones, a / SELECT(zero | overflow, one, b));                      \
+        }                                                                                        \
+        case Rem: {                                                                              \
+            S overflow = (a == TMIN) & (b == -1);                                                \
+            return SELECT(zero, a, a % SELECT(zero | overflow, one, b));                         \
+        }                                                                                        \
+        case DivU: return SELECT(zero, ones, (S)((U)a / (U)SELECT(zero, one, b)));               \
+        case RemU: return SELECT(zero, a, (S)((U)a % (U)SELECT(zero, one, b)));                  \
+        case MulAcc: return (S)((U)d + (U)a * (U)b);                                             \
+        case MulSubAcc: return (S)((U)d - (U)a * (U)b);                                          \
+        case MulAdd: return (S)((U)b * (U)d + (U)a);                                             \
+        case MulSubAdd: return (S)((U)a - (U)b * (U)d);                                          \
+        case Merge: return b;                                                                    \
+        case ElementIndex: return index;                                                         \
+        default: return d;                                                                       \
+    }                                                                                            \
+}                                                                                                \
+                                                                                                 \
+static void elementwise_##BITS(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1,   \
+                               int32_t scalar, uint32_t vl, const uint8_t *mask) {              \
+    const uint32_t lanes = VECTOR_CHUNK / sizeof(T);                                             \
+    S index;                                                                                     \
+    for (uint32_t i = 0; i < lanes; i++) index[i] = (T)i;                                        \
+    S splat = (S){0} + (T)scalar;                                                                \
+                                                                                                 \
+    for (uint32_t first = 0; first < vl; first += lanes) {                                       \
+        size_t offset = (size_t)first * sizeof(T);                                               \
+        S d, a, b;                                                                               \
+        memcpy(&d, vd + offset, VECTOR_CHUNK);                                                   \
+        memcpy(&a, vs2 + offset, VECTOR_CHUNK);                                                  \
+        if (vs1) memcpy(&b, vs1 + offset, VECTOR_CHUNK);                                         \
+        else b = splat;                                                                          \
+                                                                                                 \
+        S r = elementwise_op_##BITS(op, d, a, b, index + (T)first);                              \
+        uint32_t active = body_lanes(first, lanes, vl);                                          \
+        if (mask && op == Merge) {                                                               \
+            /* vmerge: the mask selects the source rather than the active elements */           \
+            r = SELECT(lane_mask_##BITS(read_mask_bits(mask, first, lanes)), b, a);              \
+        } else if (mask) {                                                                       \
+            active &= read_mask_bits(mask, first, lanes);                                        \
+        }                                                                                        \
+        if (active != all_lanes(lanes)) r = SELECT(lane_mask_##BITS(active), r, d);              \
+        memcpy(vd + offset, &r, VECTOR_CHUNK);                                                   \
+    }                                                                                            \
+}                                                                                                \
+                                                                                                 \
+static void compare_##BITS(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1,       \
+                           int32_t scalar, uint32_t vl, const uint8_t *mask) {                  \
+    const uint32_t lanes = VECTOR_CHUNK / sizeof(T);                                             \
+    S splat = (S){0} + (T)scalar;                                                                \
+                                                                                                 \
+    for (uint32_t first = 0; first < vl; first += lanes) {                                       \
+        size_t offset = (size_t)first * sizeof(T);                                               \
+        S a, b, r;                                                                               \
+        memcpy(&a, vs2 + offset, VECTOR_CHUNK);                                                  \
+        if (vs1) memcpy(&b, vs1 + offset, VECTOR_CHUNK);                                         \
+        else b = splat;                                                                          \
+                                                                                                 \
+        switch (op) {                                                                            \
+            case CmpEq: r = a == b; break;                                                       \
+            case CmpNe: r = a != b; break;                                                       \
+            case CmpLt: r = a < b; break;                                                        \
+            case CmpLtU: r = (U)a < (U)b; break;                                                 \
+            case CmpLe: r = a <= b; break;                                                       \
+            case CmpLeU: r = (U)a <= (U)b; break;                                                \
+            case CmpGt: r = a > b; break;                                                        \
+            case CmpGtU: r = (U)a > (U)b; break;                                                 \
+            default: r = (S){0}; break;                                                          \
+        }                                                                                        \
+                                                                                                 \
+        uint32_t bits = 0;                                                                       \
+        for (uint32_t i = 0; i < lanes; i++) bits |= (uint32_t)(r[i] & 1) << i;                  \
+        uint32_t active = body_lanes(first, lanes, vl);                                          \
+        if (mask) active &= read_mask_bits(mask, first, lanes);                                  \
+        uint32_t old = read_mask_bits(vd, first, lanes);                                         \
+        write_mask_bits(vd, first, lanes, (old & ~active) | (bits & active));                    \
+    }                                                                                            \
+}                                                                                                \
+                                                                                                 \
+static inline S combine_##BITS(AluOp op, S x, S y) {                                            \
+    switch (op) {                                                                                \
+        case RedSum: return (S)((U)x + (U)y);                                                    \
+        case RedAnd: return x & y;                                                               \
+        case RedOr: return x | y;                                                                \
+        case RedXor: return x ^ y;                                                               \
+        case RedMin: return SELECT(x < y, x, y);                                                 \
+        case RedMinU: return SELECT((U)x < (U)y, x, y);                                          \
+        case RedMax: return SELECT(x > y, x, y);                                                 \
+        case RedMaxU: return SELECT((U)x > (U)y, x, y);                                          \
+        default: return x;                                                                       \
+    }                                                                                            \
+}                                                                                                \
+                                                                                                 \
+static void reduce_##BITS(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1,        \
+                          uint32_t vl, const uint8_t *mask) {                                   \
+    const uint32_t lanes = VECTOR_CHUNK / sizeof(T);                                             \
+    T identity;                                                                                  \
+    switch (op) {                                                                                \
+        case RedAnd: case RedMinU: identity = (T)-1; break;                                      \
+        case RedMin: identity = TMAX; break;                                                     \
+        case RedMax: identity = TMIN; break;                                                     \
+        default: identity = 0; break;                                                            \
+    }                                                                                            \
+                                                                                                 \
+    /* Lane-wise partial results first, then one horizontal pass */                             \
+    S neutral = (S){0} + identity;                                                               \
+    S accumulator = neutral;                                                                     \
+    for (uint32_t first = 0; first < vl; first += lanes) {                                       \
+        S a;                                                                                     \
+        memcpy(&a, vs2 + (size_t)first * sizeof(T), VECTOR_CHUNK);                               \
+        uint32_t active = body_lanes(first, lanes, vl);                                          \
+        if (mask) active &= read_mask_bits(mask, first, lanes);                                  \
+        if (active != all_lanes(lanes)) a = SELECT(lane_mask_##BITS(active), a, neutral);        \
+        accumulator = combine_##BITS(op, accumulator, a);                                        \
+    }                                                                                            \
+                                                                                                 \
+    S result = neutral;                                                                          \
+    memcpy(&result, vs1, sizeof(T));                                                             \
+    for (uint32_t i = 0; i < lanes; i++) {                                                       \
+        S lane = neutral;                                                                        \
+        lane[0] = accumulator[i];                                                                \
+        result = combine_##BITS(op, result, lane);                                               \
+    }                                                                                            \
+    memcpy(vd, &result, sizeof(T));                                                              \
+}
+
+DEFINE_VECTOR_KERNELS(8, vi8, vu8, wi8, wu8, int8_t, INT8_MIN, INT8_MAX)
+DEFINE_VECTOR_KERNELS(16, vi16, vu16, wi16, wu16, int16_t, INT16_MIN, INT16_MAX)
+DEFINE_VECTOR_KERNELS(32, vi32, vu32, wi32, wu32, int32_t, INT32_MIN, INT32_MAX)
+
+// Indexed by vtype.vsew
+static const VectorKernels vector_kernels[3] = {
+    { elementwise_8, compare_8, reduce_8 },
+    { elementwise_16, compare_16, reduce_16 },
+    { elementwise_32, compare_32, reduce_32 },
+};
+
+static void illegal_vector_instruction(VirtualMachine *vm, const Instruction *inst) {
+    fprintf(stderr, "Illegal vector instruction: 0x%08X at PC=0x%08X\n", inst->inst, vm->program_counter - 4);
+    vm->state = VM_FAULT;
+    vm->exit_code = 1;
+}
+
+// Start of register group reg, or NULL if bytes would run past v31
+static uint8_t *vector_group(VirtualMachine *vm, uint32_t reg, uint64_t bytes) {
+    if ((uint64_t)reg * VLENB + bytes > VECTOR_REGISTER_BYTES) return NULL;
+    return vm->vregs + reg * VLENB;
+}
+
+// Returns 0 for an unsupported vtype, which sets vill
+uint32_t vector_vlmax(uint32_t vtype) {
+    uint32_t sew = 8u << ((vtype >> VTYPE_VSEW_SHIFT) & 0x7);
+    uint32_t vlmul = vtype & VTYPE_VLMUL;
+
+    if ((vtype >> 8) != 0 || sew > 32 || vlmul == 4) return 0;
+    if (vlmul < 4) return (VLEN / sew) << vlmul;
+
+    // Fractional LMUL (1/8, 1/4, 1/2) must still hold one ELEN-sized element
+    if (sew > (32u >> (8 - vlmul))) return 0;
+    return (VLEN / sew) >> (8 - vlmul);
+}
+
+// vsetvli, vsetivli and vsetvl. vl = min(AVL, VLMAX).
+static void set_vector_config(VirtualMachine *vm, const Instruction *inst, uint32_t format) {
+    uint32_t avl;
+    if (format == FMT_VSETIVLI) avl = inst->left;
+    else if (inst->rs1 != 0) avl = inst->left;
+    else if (inst->rd != 0) avl = UINT32_MAX;   // rs1 = x0: request VLMAX
+    else avl = vm->vl;                           // rd = rs1 = x0: keep vl
+
+    uint32_t vlmax = vector_vlmax(inst->right);
+    if (vlmax == 0) {
+        vm->vtype = VTYPE_VILL;
+        vm->vl = 0;
+    } else {
+        vm->vtype = inst->right;
+        vm->vl = avl < vlmax ? avl : vlmax;
+    }
+}
+
+// Moves one element the way a scalar access would: RAM (marking the page
+// dirty on a store) or else the device bus, then the plugin callback.
+// Returns -1 if nothing answers at address.
+static int vector_element_access(VirtualMachine *vm, uint32_t address, uint8_t *element, uint32_t eew, int is_store) {
+    uint32_t value = 0;
+
+    if (address <= SIZE_OF_MEMORY - eew) {
+        if (is_store) {
+            memcpy(vm->memory + address, element, eew);
+            if (vm->dirty_pages) {
+                vm->dirty_pages[address >> PAGE_SHIFT] = 1;
+                vm->dirty_pages[(address + eew - 1) >> PAGE_SHIFT] = 1;
+            }
+        } else {
+            memcpy(element, vm->memory + address, eew);
+        }
+        memcpy(&value, element, eew);
+    } else if (is_store) {
+        memcpy(&value, element, eew);
+        if (!vm->bus || bus_write(vm->bus, address, eew, value) != 0) return -1;
+    } else {
+        if (!vm->bus || bus_read(vm->bus, address, eew, &value) != 0) return -1;
+        memcpy(element, &value, eew);
+    }
+
+    if (vm->memory_plugins) plugin_memory_access(vm, address, eew, is_store, value);
+    return 0;
+}
+
+// Unit-stride, strided and mask loads and stores. An access that lies in RAM
+// and is not watched by a plugin is copied directly; anything else goes
+// element by element through vector_element_access.
+static void vector_memory(VirtualMachine *vm, const Instruction *inst, uint32_t format) {
+    int is_store = inst->opcode == 0x27;
+    int mask_transfer = format == FMT_VMEM && inst->rs2 == 0x0B;   // vlm.v / vsm.v
+    uint32_t eew = inst->funct3 == 0 ? 1 : inst->funct3 == 5 ? 2 : 4;
+    uint32_t evl = mask_transfer ? (vm->vl + 7) / 8 : vm->vl;
+    int64_t stride = format == FMT_VMEM_STRIDED ? (int32_t)inst->disp_strval : (int64_t)eew;
+
+    // EMUL = EEW / SEW * LMUL; the group only has to hold the evl elements
+    uint8_t *reg = vector_group(vm, inst->vd, (uint64_t)evl * eew);
+    if (!reg) {
+        illegal_vector_instruction(vm, inst);
+        return;
+    }
+    if (evl == 0) return;
+
+    const uint8_t *mask = (inst->funct7 & 1) ? NULL : vm->vregs;
+    int64_t base = inst->left;
+    int64_t last = base + (int64_t)(evl - 1) * stride;
+    int64_t low = stride < 0 ? last : base;
+    int64_t high = (stride < 0 ? base : last) + eew;
+
+    if (low < 0 || high > SIZE_OF_MEMORY || vm->memory_plugins) {
+        for (uint32_t i = 0; i < evl; i++) {
+            if (mask && !((mask[i >> 3] >> (i & 7)) & 1)) continue;
+            uint32_t address = (uint32_t)(base + (int64_t)i * stride);
+            if (vector_element_access(vm, address, reg + (size_t)i * eew, eew, is_store) != 0) {
+                fprintf(stderr, "Memory access out of bounds: 0x%08X\n", address);
+                vm->state = VM_FAULT;
+                vm->exit_code = 1;
+                return;
+            }
+        }
+        return;
+    }
+
+    if (!mask && stride == eew) {
+        if (is_store) memcpy(vm->memory + base, reg, (size_t)evl * eew);
+        else memcpy(reg, vm->memory + base, (size_t)evl * eew);
+    } else {
+        for (uint32_t i = 0; i < evl; i++) {
+            if (mask && !((mask[i >> 3] >> (i & 7)) & 1)) continue;
+            uint8_t *element = vm->memory + base + (int64_t)i * stride;
+            if (is_store) memcpy(element, reg + (size_t)i * eew, eew);
+            else memcpy(reg + (size_t)i * eew, element, eew);
+        }
+    }
+
+    if (is_store && vm->dirty_pages) {
+        for (int64_t page = low >> PAGE_SHIFT; page <= (high - 1) >> PAGE_SHIFT; page++) {
+            vm->dirty_pages[page] = 1;
+        }
+    }
+}
+
+// Mask-register logical operations, 64 mask bits at a time
+static void mask_logical(AluOp op, uint8_t *vd, const uint8_t *vs2, const uint8_t *vs1, uint32_t vl) {
+    for (uint32_t first = 0; first < vl; first += 64) {
+        uint64_t d, a, b, r;
+        memcpy(&d, vd + first / 8, sizeof(d));
+        memcpy(&a, vs2 + first / 8, sizeof(a));
+        memcpy(&b, vs1 + first / 8, sizeof(b));
+
+        switch (op) {
+            case MaskAnd: r = a & b; break;
+            case MaskNand: r = ~(a & b); break;
+            case MaskAndNot: r = a & ~b; break;
+            case MaskOr: r = a | b; break;
+            case MaskNor: r = ~(a | b); break;
+            case MaskOrNot: r = a | ~b; break;
+            case MaskXor: r = a ^ b; break;
+            default: r = ~(a ^ b); break;  // MaskXnor
+        }
+
+        uint64_t active = vl - first >= 64 ? ~0ull : (1ull << (vl - first)) - 1;
+        r = (r & active) | (d & ~active);
+        memcpy(vd + first / 8, &r, sizeof(r));
+    }
+}
+
+// vmv.x.s, vcpop.m and vfirst.m: the result goes to scalar rd
+static int32_t vector_to_scalar(VirtualMachine *vm, const Instruction *inst, uint32_t sew) {
+    const uint8_t *vs2 = vm->vregs + inst->rs2 * VLENB;
+
+    if (inst->aluop == MoveToScalar) {
+        int32_t value = 0;
+        memcpy(&value, vs2, sew / 8);
+        return extend_sign_bit(value, sew - 1);
+    }
+
+    const uint8_t *mask = (inst->funct7 & 1) ? NULL : vm->vregs;
+    int32_t count = 0;
+    for (uint32_t first = 0; first < vm->vl; first += 32) {
+        uint32_t bits = read_mask_bits(vs2, first, 32) & body_lanes(first, 32, vm->vl);
+        if (mask) bits &= read_mask_bits(mask, first, 32);
+
+        if (inst->aluop == MaskFirst) {
+            if (bits) return (int32_t)first + __builtin_ctz(bits);
+        } else {
+            count += __builtin_popcount(bits);
+        }
+    }
+    return inst->aluop == MaskFirst ? -1 : count;
+}
+
+void execute_vector_instruction(VirtualMachine *vm, const Instruction *inst, int32_t *result) {
+    uint32_t format = instruction_table[inst->id].format;
+    AluOp op = (AluOp)inst->aluop;
+
+    if (format == FMT_VSETVLI || format == FMT_VSETIVLI || format == FMT_VSETVL) {
+        set_vector_config(vm, inst, format);
+        *result = (int32_t)vm->vl;
+        if (vm->trace) printf("vl = %u, vtype = 0x%08X\n", vm->vl, vm->vtype);
+        return;
+    }
+
+    // Every other vector instruction needs a valid vtype
+    uint32_t vsew = (vm->vtype >> VTYPE_VSEW_SHIFT) & 0x7;
+    if (vector_vlmax(vm->vtype) == 0) {
+        illegal_vector_instruction(vm, inst);
+        return;
+    }
+    uint32_t sew = 8u << vsew;
+    uint32_t vl = vm->vl;
+
+    if (format == FMT_VMEM || format == FMT_VMEM_STRIDED) {
+        vector_memory(vm, inst, format);
+        return;
+    }
+    if (format == FMT_VTOX) {
+        *result = vector_to_scalar(vm, inst, sew);
+        return;
+    }
+
+    const VectorKernels *kernels = &vector_kernels[vsew];
+    const uint8_t *mask = (inst->funct7 & 1) ? NULL : vm->vregs;
+    uint64_t group_bytes = (uint64_t)vl * (sew / 8);
+    uint64_t mask_bytes = (vl + 7) / 8;
+    int vector_source = format != FMT_VDEST && (inst->funct3 == 0 || inst->funct3 == 2);   // OPIVV / OPMVV
+
+    if (op >= CmpEq && op <= CmpGtU) {
+        uint8_t *vd = vector_group(vm, inst->vd, mask_bytes);
+        const uint8_t *vs2 = vector_group(vm, inst->rs2, group_bytes);
+        const uint8_t *vs1 = vector_source ? vector_group(vm, inst->rs1, group_bytes) : NULL;
+        if (!vd || !vs2 || (vector_source && !vs1)) {
+            illegal_vector_instruction(vm, inst);
+            return;
+        }
+        kernels->compare(op, vd, vs2, vs1, (int32_t)inst->left, vl, mask);
+    } else if (op >= RedSum && op <= RedMaxU) {
+        uint8_t *vd = vector_group(vm, inst->vd, sew / 8);
+        const uint8_t *vs2 = vector_group(vm, inst->rs2, group_bytes);
+        const uint8_t *vs1 = vector_group(vm, inst->rs1, sew / 8);
+        if (!vd || !vs2 || !vs1) {
+            illegal_vector_instruction(vm, inst);
+            return;
+        }
+        if (vl > 0) kernels->reduce(op, vd, vs2, vs1, vl, mask);
+    } else if (op >= MaskAnd && op <= MaskXnor) {
+        // Mask registers are single registers, so these cannot run past v31
+        mask_logical(op, vm->vregs + inst->vd * VLENB, vm->vregs + inst->rs2 * VLENB,
+                     vm->vregs + inst->rs1 * VLENB, vl);
+    } else if (op == MoveFromScalar) {
+        // vmv.s.x writes element 0 only
+        if (vl > 0) memcpy(vm->vregs + inst->vd * VLENB, &inst->left, sew / 8);
+    } else {
+        uint8_t *vd = vector_group(vm, inst->vd, group_bytes);
+        const uint8_t *vs2 = vector_group(vm, inst->rs2, group_bytes);
+        const uint8_t *vs1 = vector_source ? vector_group(vm, inst->rs1, group_bytes) : NULL;
+        if (!vd || !vs2 || (vector_source && !vs1)) {
+            illegal_vector_instruction(vm, inst);
+            return;
+        }
+        kernels->elementwise(op, vd, vs2, vs1, (int32_t)inst->left, vl, mask);
+    }
+}
+
+void format_vtype(uint32_t vtype, char *buffer, size_t size) {
+    uint32_t vlmul = vtype & VTYPE_VLMUL;
+    if ((vtype >> 8) != 0 || vlmul == 4 || ((vtype >> VTYPE_VSEW_SHIFT) & 0x7) > 3) {
+        snprintf(buffer, size, "0x%X", vtype);
+        return;
+    }
+
+    snprintf(buffer, size, "e%u, %s%u, %s, %s",
+             8u << ((vtype >> VTYPE_VSEW_SHIFT) & 0x7),
+             vlmul < 4 ? "m" : "mf", vlmul < 4 ? 1u << vlmul : 1u << (8 - vlmul),
+             (vtype & VTYPE_VTA) ? "ta" : "tu", (vtype & VTYPE_VMA) ? "ma" : "mu");
+}
+
+// Bits for the registers of a group of regs registers starting at reg
+static uint32_t group_bits(uint32_t reg, uint32_t regs) {
+    return (uint32_t)(((1ull << regs) - 1) << reg);
+}
+
+// Records in vreads and vwrites the vector registers the instruction reads
+// and writes under the current vtype, whole register groups at a time, for
+// the timing models. Destinations that are only partly written (masked
+// operations, multiply-adds and element-0 results) are also sources.
+void decode_vector_operands(const VirtualMachine *vm, Instruction *inst) {
+    uint32_t format = instruction_table[inst->id].format;
+    AluOp op = (AluOp)inst->aluop;
+    if (format == FMT_VSETVLI || format == FMT_VSETIVLI || format == FMT_VSETVL) return;
+
+    // LMUL in eighths of a register; an invalid vtype faults on execute anyway
+    uint32_t vlmul = vm->vtype & VTYPE_VLMUL;
+    uint32_t sew = 8u << ((vm->vtype >> VTYPE_VSEW_SHIFT) & 0x7);
+    uint32_t lmul_eighths = vector_vlmax(vm->vtype) == 0 ? 8 : vlmul < 4 ? 8u << vlmul : 8u >> (8 - vlmul);
+    uint32_t group = lmul_eighths < 8 ? 1 : lmul_eighths / 8;
+    int masked = !(inst->funct7 & 1);
+
+    if (format == FMT_VMEM || format == FMT_VMEM_STRIDED) {
+        // EMUL = EEW / SEW * LMUL, one register for vlm.v / vsm.v
+        uint32_t eew = inst->funct3 == 0 ? 8 : inst->funct3 == 5 ? 16 : 32;
+        uint32_t emul_eighths = lmul_eighths * eew / sew;
+        uint32_t regs = format == FMT_VMEM && inst->rs2 == 0x0B ? 1 : emul_eighths < 8 ? 1 : emul_eighths / 8;
+        uint32_t data = group_bits(inst->vd, regs);
+        if (inst->opcode == 0x27) {
+            inst->vreads = data;
+        } else {
+            inst->vwrites = data;
+            if (masked) inst->vreads = data;
+        }
+        if (masked) inst->vreads |= 1;
+        return;
+    }
+
+    int vector_source = format != FMT_VDEST && (inst->funct3 == 0 || inst->funct3 == 2);   // OPIVV / OPMVV
+    uint32_t destination = 0;
+
+    if (format == FMT_VTOX) {
+        // vmv.x.s reads element 0, vcpop.m and vfirst.m a mask register
+        inst->vreads = group_bits(inst->rs2, 1);
+    } else if (format == FMT_VMOVE) {
+        // vmv.v.* and vmv.s.x have no vs2
+        if (vector_source) inst->vreads = group_bits(inst->rs1, group);
+        destination = group_bits(inst->vd, op == MoveFromScalar ? 1 : group);
+        if (op == MoveFromScalar) inst->vreads |= destination;
+    } else if (op >= CmpEq && op <= CmpGtU) {
+        inst->vreads = group_bits(inst->rs2, group);
+        if (vector_source) inst->vreads |= group_bits(inst->rs1, group);
+        destination = group_bits(inst->vd, 1);
+    } else if (op >= RedSum && op <= RedMaxU) {
+        inst->vreads = group_bits(inst->rs2, group) | group_bits(inst->rs1, 1);
+        destination = group_bits(inst->vd, 1);
+        inst->vreads |= destination;
+    } else if (op >= MaskAnd && op <= MaskXnor) {
+        inst->vreads = group_bits(inst->rs2, 1) | group_bits(inst->rs1, 1);
+        destination = group_bits(inst->vd, 1);
+    } else {
+        if (format != FMT_VDEST) inst->vreads = group_bits(inst->rs2, group);
+        if (vector_source) inst->vreads |= group_bits(inst->rs1, group);
+        destination = group_bits(inst->vd, group);
+        if (op == MulAcc || op == MulSubAcc || op == MulAdd || op == MulSubAdd) inst->vreads |= destination;
+    }
+
+    // vmerge selects every body element, so its mask does not leave vd partly written
+    if (masked) {
+        inst->vreads |= 1;
+        if (op != Merge) inst->vreads |= destination;
+    }
+    inst->vwrites = destination;
+}
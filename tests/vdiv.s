@@ -0,0 +1,108 @@
+# Vector division: vdiv, vrem, vdivu and vremu at every SEW, including
+# division by zero (quotient all ones, remainder the dividend) and the
+# signed overflow of the most negative value divided by -1 (quotient the
+# dividend, remainder zero). Exits with 0 when every result matches,
+# otherwise with the number of the first failing check.
+
+.global _start
+
+# Four elements of a op b (vs2 = a, vs1 = b), compared with want
+.macro vv num, sew, op, a, b, want
+    li t0, 4
+    vsetvli zero, t0, e\sew, m2, tu, mu
+    la t1, \a
+    vle\sew\().v v2, (t1)
+    la t1, \b
+    vle\sew\().v v4, (t1)
+    \op\().vv v6, v2, v4
+    la t1, out
+    vse\sew\().v v6, (t1)
+    li a0, \num
+    la a2, \want
+    li a3, 4 * \sew / 8
+    call check
+.endm
+
+# Four elements of a op x, compared with want
+.macro vx num, sew, op, a, x, want
+    li t0, 4
+    vsetvli zero, t0, e\sew, m2, tu, mu
+    la t1, \a
+    vle\sew\().v v2, (t1)
+    li t2, \x
+    \op\().vx v6, v2, t2
+    la t1, out
+    vse\sew\().v v6, (t1)
+    li a0, \num
+    la a2, \want
+    li a3, 4 * \sew / 8
+    call check
+.endm
+
+.text
+_start:
+    vv 1, 8, vdiv, a8, b8, div8
+    vv 2, 8, vrem, a8, b8, rem8
+    vv 3, 8, vdivu, a8, b8, divu8
+    vv 4, 8, vremu, a8, b8, remu8
+    vv 5, 16, vdiv, a16, b16, div16
+    vv 6, 16, vrem, a16, b16, rem16
+    vv 7, 16, vdivu, a16, b16, divu16
+    vv 8, 16, vremu, a16, b16, remu16
+    vv 9, 32, vdiv, a32, b32, div32
+    vv 10, 32, vrem, a32, b32, rem32
+    vv 11, 32, vdivu, a32, b32, divu32
+    vv 12, 32, vremu, a32, b32, remu32
+
+    vx 13, 32, vdiv, a32, 0, ones32
+    vx 14, 32, vremu, a32, 0, a32
+    vx 15, 16, vdiv, a16, -1, div16_minus1
+
+    li a0, 0
+    li a7, 93
+    ecall
+
+# Compares a3 bytes at out with a2 and exits with a0 on a mismatch
+check:
+    la a1, out
+1:  beqz a3, 2f
+    lbu t0, 0(a1)
+    lbu t1, 0(a2)
+    bne t0, t1, fail
+    addi a1, a1, 1
+    addi a2, a2, 1
+    addi a3, a3, -1
+    j 1b
+2:  ret
+
+fail:
+    li a7, 93
+    ecall
+
+.data
+a8:             .byte 0x07, 0xF9, 0x80, 0x05
+b8:             .byte 0xFE, 0x00, 0xFF, 0x00
+div8:           .byte 0xFD, 0xFF, 0x80, 0xFF
+rem8:           .byte 0x01, 0xF9, 0x00, 0x05
+divu8:          .byte 0x00, 0xFF, 0x00, 0xFF
+remu8:          .byte 0x07, 0xF9, 0x80, 0x05
+
+.balign 2
+a16:            .half 0x0007, 0xFFF9, 0x8000, 0x0005
+b16:            .half 0xFFFE, 0x0000, 0xFFFF, 0x0000
+div16:          .half 0xFFFD, 0xFFFF, 0x8000, 0xFFFF
+rem16:          .half 0x0001, 0xFFF9, 0x0000, 0x0005
+divu16:         .half 0x0000, 0xFFFF, 0x0000, 0xFFFF
+remu16:         .half 0x0007, 0xFFF9, 0x8000, 0x0005
+div16_minus1:   .half 0xFFF9, 0x0007, 0x8000, 0xFFFB
+
+.balign 4
+a32:            .word 0x00000007, 0xFFFFFFF9, 0x80000000, 0x00000005
+b32:            .word 0xFFFFFFFE, 0x00000000, 0xFFFFFFFF, 0x00000000
+div32:          .word 0xFFFFFFFD, 0xFFFFFFFF, 0x80000000, 0xFFFFFFFF
+rem32:          .word 0x00000001, 0xFFFFFFF9, 0x00000000, 0x00000005
+divu32:         .word 0x00000000, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF
+remu32:         .word 0x00000007, 0xFFFFFFF9, 0x80000000, 0x00000005
+ones32:         .word 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+
+out:            .space 16
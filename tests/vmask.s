@@ -0,0 +1,119 @@
+# Masked vector operations at e32 with vl = 4: inactive elements and mask
+# bits stay undisturbed, and vmerge, masked reductions, masked loads and
+# stores and the mask-register instructions only use active elements.
+# Exits with 0 when every result matches, otherwise with the number of the
+# first failing check.
+
+.global _start
+
+# Exits with num unless reg holds value
+.macro expect num, reg, value
+    li a0, \num
+    li t1, \value
+    bne \reg, t1, fail
+.endm
+
+# Compares the four words at out with want
+.macro compare num, want
+    li a0, \num
+    la a2, \want
+    li a3, 16
+    call check
+.endm
+
+.text
+_start:
+    li t0, 4
+    vsetvli zero, t0, e32, m2, tu, mu
+    la t1, a32
+    vle32.v v2, (t1)
+    la t1, b32
+    vle32.v v4, (t1)
+    la s0, old32
+    la s1, out
+
+    # v0 = 0b0101: elements 0 and 2 active
+    li t0, 0x5
+    vmv.s.x v0, t0
+    vle32.v v6, (s0)
+    vadd.vv v6, v2, v4, v0.t
+    vse32.v v6, (s1)
+    compare 1, masked_add
+
+    # v0 = 0b1010 from the sign of a; vmerge takes a where the mask is set
+    vmslt.vx v0, v2, zero
+    vmerge.vvm v6, v4, v2, v0
+    vse32.v v6, (s1)
+    compare 2, merged
+
+    # A masked compare leaves inactive mask bits alone; bits past vl may
+    # be anything, so only the low four are checked
+    li t0, 0x5
+    vmv.s.x v8, t0
+    vmseq.vv v8, v2, v2, v0.t
+    vmv.x.s t0, v8
+    andi t0, t0, 0xF
+    expect 3, t0, 0xF
+
+    # Only active elements join the sum: 10 + -2 + -4
+    vredsum.vs v6, v2, v4, v0.t
+    vmv.x.s t0, v6
+    expect 4, t0, 4
+
+    vle32.v v6, (s0)
+    la t1, b32
+    vle32.v v6, (t1), v0.t
+    vse32.v v6, (s1)
+    compare 5, masked_load
+
+    vle32.v v6, (s0)
+    vse32.v v6, (s1)
+    vse32.v v4, (s1), v0.t
+    compare 6, masked_load
+
+    vcpop.m t0, v8
+    expect 7, t0, 4
+    vcpop.m t0, v8, v0.t
+    expect 8, t0, 2
+    vfirst.m t0, v0
+    expect 9, t0, 1
+    vmxor.mm v10, v0, v0
+    vfirst.m t0, v10
+    expect 10, t0, -1
+    vmandn.mm v10, v8, v0
+    vcpop.m t0, v10
+    expect 11, t0, 2
+    vfirst.m t0, v10
+    expect 12, t0, 0
+
+    li a0, 0
+    li a7, 93
+    ecall
+
+# Compares a3 bytes at out with a2 and exits with a0 on a mismatch
+check:
+    la a1, out
+1:  beqz a3, 2f
+    lbu t0, 0(a1)
+    lbu t1, 0(a2)
+    bne t0, t1, fail
+    addi a1, a1, 1
+    addi a2, a2, 1
+    addi a3, a3, -1
+    j 1b
+2:  ret
+
+fail:
+    li a7, 93
+    ecall
+
+.data
+.balign 4
+a32:            .word 1, -2, 3, -4
+b32:            .word 10, 20, 30, 40
+old32:          .word 0x11111111, 0x22222222, 0x33333333, 0x44444444
+masked_add:     .word 11, 0x22222222, 33, 0x44444444
+merged:         .word 10, -2, 30, -4
+masked_load:    .word 0x11111111, 20, 0x33333333, 40
+
+out:            .space 16
@@ -0,0 +1,103 @@
+# Vector high-half multiplies: vmulh, vmulhu and vmulhsu at every SEW, with
+# the most negative value, -1 and the largest positive value as operands.
+# Exits with 0 when every result matches, otherwise with the number of the
+# first failing check.
+
+.global _start
+
+# Four elements of a op b (vs2 = a, vs1 = b), compared with want
+.macro vv num, sew, op, a, b, want
+    li t0, 4
+    vsetvli zero, t0, e\sew, m2, tu, mu
+    la t1, \a
+    vle\sew\().v v2, (t1)
+    la t1, \b
+    vle\sew\().v v4, (t1)
+    \op\().vv v6, v2, v4
+    la t1, out
+    vse\sew\().v v6, (t1)
+    li a0, \num
+    la a2, \want
+    li a3, 4 * \sew / 8
+    call check
+.endm
+
+# Four elements of a op x, compared with want
+.macro vx num, sew, op, a, x, want
+    li t0, 4
+    vsetvli zero, t0, e\sew, m2, tu, mu
+    la t1, \a
+    vle\sew\().v v2, (t1)
+    li t2, \x
+    \op\().vx v6, v2, t2
+    la t1, out
+    vse\sew\().v v6, (t1)
+    li a0, \num
+    la a2, \want
+    li a3, 4 * \sew / 8
+    call check
+.endm
+
+.text
+_start:
+    vv 1, 8, vmulh, a8, b8, mulh8
+    vv 2, 8, vmulhu, a8, b8, mulhu8
+    vv 3, 8, vmulhsu, a8, b8, mulhsu8
+    vv 4, 16, vmulh, a16, b16, mulh16
+    vv 5, 16, vmulhu, a16, b16, mulhu16
+    vv 6, 16, vmulhsu, a16, b16, mulhsu16
+    vv 7, 32, vmulh, a32, b32, mulh32
+    vv 8, 32, vmulhu, a32, b32, mulhu32
+    vv 9, 32, vmulhsu, a32, b32, mulhsu32
+
+    # The scalar operand is truncated to SEW, so -1 is 0xFFFF for vmulhsu.vx at e16
+    vx 10, 32, vmulh, a32, -1, mulh32_minus1
+    vx 11, 32, vmulhu, a32, -1, mulhu32_ones
+    vx 12, 16, vmulhsu, a16, -1, mulhsu16_ones
+
+    li a0, 0
+    li a7, 93
+    ecall
+
+# Compares a3 bytes at out with a2 and exits with a0 on a mismatch
+check:
+    la a1, out
+1:  beqz a3, 2f
+    lbu t0, 0(a1)
+    lbu t1, 0(a2)
+    bne t0, t1, fail
+    addi a1, a1, 1
+    addi a2, a2, 1
+    addi a3, a3, -1
+    j 1b
+2:  ret
+
+fail:
+    li a7, 93
+    ecall
+
+.data
+a8:             .byte 0x80, 0xFF, 0x7F, 0x03
+b8:             .byte 0x80, 0x7F, 0xFF, 0xFB
+mulh8:          .byte 0x40, 0xFF, 0xFF, 0xFF
+mulhu8:         .byte 0x40, 0x7E, 0x7E, 0x02
+mulhsu8:        .byte 0xC0, 0xFF, 0x7E, 0x02
+
+.balign 2
+a16:            .half 0x8000, 0xFFFF, 0x7FFF, 0x0003
+b16:            .half 0x8000, 0x7FFF, 0xFFFF, 0xFFFB
+mulh16:         .half 0x4000, 0xFFFF, 0xFFFF, 0xFFFF
+mulhu16:        .half 0x4000, 0x7FFE, 0x7FFE, 0x0002
+mulhsu16:       .half 0xC000, 0xFFFF, 0x7FFE, 0x0002
+mulhsu16_ones:  .half 0x8000, 0xFFFF, 0x7FFE, 0x0002
+
+.balign 4
+a32:            .word 0x80000000, 0xFFFFFFFF, 0x7FFFFFFF, 0x00000003
+b32:            .word 0x80000000, 0x7FFFFFFF, 0xFFFFFFFF, 0xFFFFFFFB
+mulh32:         .word 0x40000000, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+mulhu32:        .word 0x40000000, 0x7FFFFFFE, 0x7FFFFFFE, 0x00000002
+mulhsu32:       .word 0xC0000000, 0xFFFFFFFF, 0x7FFFFFFE, 0x00000002
+mulh32_minus1:  .word 0x00000000, 0x00000000, 0xFFFFFFFF, 0xFFFFFFFF
+mulhu32_ones:   .word 0x7FFFFFFF, 0xFFFFFFFE, 0x7FFFFFFE, 0x00000002
+
+out:            .space 16
@@ -0,0 +1,149 @@
+# Vector length and tail handling: AVL clamping to VLMAX, keeping vl when
+# vsetvli has rd = rs1 = x0, tail elements left undisturbed under tu,
+# vl = 0, vill for LMUL=1/8, fractional LMUL and zero and negative strides.
+# Exits with 0 when every result matches, otherwise with the number of the
+# first failing check.
+
+.global _start
+
+# Exits with num unless reg holds value
+.macro expect num, reg, value
+    li a0, \num
+    li t1, \value
+    bne \reg, t1, fail
+.endm
+
+# Compares the four words at out with want
+.macro compare num, want
+    li a0, \num
+    la a2, \want
+    li a3, 16
+    call check
+.endm
+
+.text
+_start:
+    la s0, old32
+    la s1, out
+    csrr s2, vlenb
+
+    # AVL beyond VLMAX gives vl = VLMAX = VLEN / 32 at e32, m1
+    li t0, 0x7FFFFFFF
+    vsetvli t2, t0, e32, m1, tu, mu
+    srli t3, s2, 2
+    li a0, 1
+    bne t2, t3, fail
+    csrr t4, vl
+    li a0, 2
+    bne t4, t3, fail
+
+    # rd = rs1 = x0 changes vtype but keeps vl when SEW/LMUL is unchanged
+    li t0, 3
+    vsetvli zero, t0, e32, m2, tu, mu
+    vsetvli zero, zero, e16, m1, tu, mu
+    csrr t0, vl
+    expect 3, t0, 3
+    csrr t0, vtype
+    expect 4, t0, 0x08
+
+    # vadd at vl = 3 leaves element 3 of the destination alone
+    li t0, 4
+    vsetvli zero, t0, e32, m2, tu, mu
+    la t1, a32
+    vle32.v v2, (t1)
+    la t1, b32
+    vle32.v v4, (t1)
+    vle32.v v6, (s0)
+    li t0, 3
+    vsetvli zero, t0, e32, m2, tu, mu
+    vadd.vv v6, v2, v4
+    li t0, 4
+    vsetvli zero, t0, e32, m2, tu, mu
+    vse32.v v6, (s1)
+    compare 5, tail_add
+
+    # At vl = 0 nothing is written, but vmv.x.s still reads element 0
+    vle32.v v6, (s0)
+    vse32.v v6, (s1)
+    vsetivli zero, 0, e32, m2, tu, mu
+    csrr t0, vl
+    expect 6, t0, 0
+    vadd.vv v6, v4, v4
+    li t0, 99
+    vmv.s.x v6, t0
+    vse32.v v4, (s1)
+    vmv.x.s t0, v2
+    expect 7, t0, 1
+    compare 8, old32
+    li t0, 4
+    vsetvli zero, t0, e32, m2, tu, mu
+    vse32.v v6, (s1)
+    compare 9, old32
+
+    # LMUL = 1/8 cannot hold a 32-bit element, so the vtype is illegal
+    li t0, 4
+    vsetvli t2, t0, e8, mf8, tu, mu
+    expect 10, t2, 0
+    csrr t0, vtype
+    li a0, 11
+    bgez t0, fail
+
+    # e16, mf2 is legal with VLMAX = VLEN / 32
+    li t0, 4
+    vsetvli t2, t0, e16, mf2, tu, mu
+    srli t3, s2, 2
+    bleu t3, t0, 1f
+    mv t3, t0
+1:  li a0, 12
+    bne t2, t3, fail
+
+    # A zero stride broadcasts one element; a negative one walks backwards
+    li t0, 4
+    vsetvli zero, t0, e32, m2, tu, mu
+    la t1, b32
+    vlse32.v v6, (t1), zero
+    vse32.v v6, (s1)
+    compare 13, broadcast
+    li t0, -4
+    la t1, b32 + 12
+    vlse32.v v6, (t1), t0
+    vse32.v v6, (s1)
+    compare 14, reversed
+    vle32.v v6, (s0)
+    vse32.v v6, (s1)
+    li t0, -4
+    la t1, out + 12
+    vsse32.v v4, (t1), t0
+    compare 15, reversed
+
+    li a0, 0
+    li a7, 93
+    ecall
+
+# Compares a3 bytes at out with a2 and exits with a0 on a mismatch
+check:
+    la a1, out
+1:  beqz a3, 2f
+    lbu t0, 0(a1)
+    lbu t1, 0(a2)
+    bne t0, t1, fail
+    addi a1, a1, 1
+    addi a2, a2, 1
+    addi a3, a3, -1
+    j 1b
+2:  ret
+
+fail:
+    li a7, 93
+    ecall
+
+.data
+.balign 4
+a32:            .word 1, -2, 3, -4
+b32:            .word 10, 20, 30, 40
+old32:          .word 0x11111111, 0x22222222, 0x33333333, 0x44444444
+tail_add:       .word 11, 18, 33, 0x44444444
+broadcast:      .word 10, 10, 10, 10
+reversed:       .word 40, 30, 20, 10
+
+out:            .space 16